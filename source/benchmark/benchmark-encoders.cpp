@@ -0,0 +1,456 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "benchmark-encoders.hpp"
+#include "benchmark.hpp"
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include "obs/obs-tools.hpp"
+#include "util/util-logging.hpp"
+
+#ifdef ENABLE_ENCODER_AOM_AV1
+#include "encoders/encoder-aom-av1.hpp"
+#endif
+
+#ifdef ENABLE_ENCODER_FFMPEG
+#include "encoders/encoder-ffmpeg.hpp"
+#endif
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<benchmark::encoders> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+#define ST_WIDTH 1920
+#define ST_HEIGHT 1080
+// A fractional frame rate, so that timestamps advance by more than one per frame like they do in OBS.
+#define ST_FPS_NUM 60000
+#define ST_FPS_DEN 1001
+
+// Encoders set up some of their state lazily, percentiles keep the first frames from skewing the results.
+#define ST_FRAMES 120
+
+enum class pattern {
+	GRADIENT, // Smooth motion, which rewards motion search.
+	NOISE,    // Incompressible, the worst case for rate control and entropy coding.
+	SCREEN,   // Flat areas and sharp edges, like a desktop or game UI.
+};
+
+static const std::pair<pattern, const char*> patterns[] = {
+	{pattern::GRADIENT, "gradient"},
+	{pattern::NOISE, "noise"},
+	{pattern::SCREEN, "screen"},
+};
+
+struct plane {
+	uint32_t shift_x; // Horizontal chroma subsampling.
+	uint32_t shift_y; // Vertical chroma subsampling.
+	uint32_t components;
+	uint32_t bytes;
+};
+
+struct format {
+	video_format       id;
+	const char*        name;
+	std::vector<plane> planes;
+};
+
+static const std::vector<format> formats = {
+	{VIDEO_FORMAT_NV12, "NV12", {{0, 0, 1, 1}, {1, 1, 2, 1}}},
+	{VIDEO_FORMAT_I420, "I420", {{0, 0, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1}}},
+	{VIDEO_FORMAT_I444, "I444", {{0, 0, 1, 1}, {0, 0, 1, 1}, {0, 0, 1, 1}}},
+#if LIBOBS_API_MAJOR_VER >= 28
+	{VIDEO_FORMAT_P010, "P010", {{0, 0, 1, 2}, {1, 1, 2, 2}}},
+#endif
+};
+
+// Zero lets the encoder decide.
+static const int64_t thread_counts[] = {1, 4, 0};
+
+struct codec;
+
+struct result {
+	const codec*  test;
+	const format* fmt;
+	pattern       kind;
+	const char*   kind_name;
+	int64_t       threads;
+
+	uint64_t packets;
+	uint64_t latency_total;
+	uint64_t latency_max;
+
+	std::shared_ptr<streamfx::util::profiler> copy;
+	std::shared_ptr<streamfx::util::profiler> convert;
+	std::shared_ptr<streamfx::util::profiler> encode;
+	std::shared_ptr<streamfx::util::profiler> total;
+};
+
+struct codec {
+	const char*                      id;
+	const char*                      name;
+	const char*                      threads_key;
+	std::function<void(obs_data_t*)> configure;
+	void (*run)(result& res, obs_data_t* settings, obs_encoder_t* encoder);
+};
+
+struct frame_buffer {
+	const format*                     fmt;
+	std::vector<std::vector<uint8_t>> planes;
+	encoder_frame                     frame;
+};
+
+static std::atomic<bool> _running{false};
+
+static void allocate(frame_buffer& buffer, const format& fmt)
+{
+	buffer.fmt   = &fmt;
+	buffer.frame = {};
+	buffer.planes.resize(fmt.planes.size());
+	for (std::size_t idx = 0; idx < fmt.planes.size(); idx++) {
+		auto&       pl       = fmt.planes[idx];
+		std::size_t linesize = (((ST_WIDTH >> pl.shift_x) * pl.components * pl.bytes) + 31) & ~std::size_t(31);
+
+		buffer.planes[idx].resize(linesize * (ST_HEIGHT >> pl.shift_y));
+		buffer.frame.data[idx]     = buffer.planes[idx].data();
+		buffer.frame.linesize[idx] = static_cast<uint32_t>(linesize);
+	}
+}
+
+static uint8_t sample(pattern kind, uint32_t x, uint32_t y, uint32_t frame, std::size_t channel, uint32_t& seed)
+{
+	switch (kind) {
+	case pattern::GRADIENT:
+		if (channel == 0) {
+			return static_cast<uint8_t>(x + y + frame * 4);
+		} else if (channel == 1) {
+			return static_cast<uint8_t>(x / 2 + frame * 2);
+		} else {
+			return static_cast<uint8_t>(y / 2 + frame);
+		}
+	case pattern::NOISE:
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		return static_cast<uint8_t>(seed >> 24);
+	case pattern::SCREEN: {
+		// A window moving over a page of scrolling text. Unsigned, so that left of or above the window is outside too.
+		uint32_t wx = (frame * 8) % (ST_WIDTH - ST_WIDTH / 4);
+		uint32_t wy = (frame * 4) % (ST_HEIGHT - ST_HEIGHT / 4);
+		if (((x - wx) < (ST_WIDTH / 4)) && ((y - wy) < (ST_HEIGHT / 4))) {
+			return (channel == 0) ? 0x80 : ((channel == 1) ? 0x40 : 0xC0);
+		} else if (channel != 0) {
+			return 0x80;
+		}
+
+		uint32_t line  = (y + frame * 2) / 20;
+		uint32_t row   = (y + frame * 2) % 20;
+		uint32_t glyph = x / 10;
+		bool     ink   = (row < 14) && ((x % 10) < 7) && (((line * 7 + glyph * 13) % 11) > 3)
+				   && (((x * 3 + row * 5) % 4) != 0);
+		return ink ? 0x20 : 0xEB;
+	}
+	}
+	return 0;
+}
+
+static void fill(frame_buffer& buffer, pattern kind, uint32_t frame)
+{
+	uint32_t seed = ((frame + 1) * 0x9E3779B9u) | 1;
+	for (std::size_t idx = 0; idx < buffer.fmt->planes.size(); idx++) {
+		auto&    pl     = buffer.fmt->planes[idx];
+		uint32_t width  = ST_WIDTH >> pl.shift_x;
+		uint32_t height = ST_HEIGHT >> pl.shift_y;
+		for (uint32_t y = 0; y < height; y++) {
+			uint8_t* row = buffer.frame.data[idx] + static_cast<std::size_t>(buffer.frame.linesize[idx]) * y;
+			for (uint32_t x = 0; x < width; x++) {
+				for (uint32_t comp = 0; comp < pl.components; comp++) {
+					// Interleaved planes hold both chroma channels.
+					std::size_t channel = (pl.components > 1) ? (1 + comp) : idx;
+					uint8_t     value   = sample(kind, x << pl.shift_x, y << pl.shift_y, frame, channel, seed);
+					std::size_t offset  = static_cast<std::size_t>(x) * pl.components + comp;
+					if (pl.bytes == 2) { // Little endian, with the significant bits at the top.
+						row[offset * 2]     = 0;
+						row[offset * 2 + 1] = value;
+					} else {
+						row[offset] = value;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Only some encoders convert the input, the others report nothing.
+template<typename T>
+static std::shared_ptr<streamfx::util::profiler> get_profiler_convert(T*)
+{
+	return nullptr;
+}
+
+#ifdef ENABLE_ENCODER_FFMPEG
+static std::shared_ptr<streamfx::util::profiler>
+	get_profiler_convert(streamfx::encoder::ffmpeg::ffmpeg_instance* instance)
+{
+	return instance->get_profiler_convert();
+}
+#endif
+
+// Encoders which measure their own latency must agree with what was observed here.
+template<typename T>
+static void check_latency(T*, const result&)
+{}
+
+#ifdef ENABLE_ENCODER_AOM_AV1
+static void check_latency(streamfx::encoder::aom::av1::aom_av1_instance* instance, const result& res)
+{
+	if (auto latency = instance->get_packet_latency(); latency.second != res.latency_max) {
+		D_LOG_WARNING("Encoder reported a maximum latency of %" PRIu64 " frames, but %" PRIu64 " were observed.",
+					  latency.second, res.latency_max);
+	}
+}
+#endif
+
+template<typename T>
+static void encode(result& res, obs_data_t* settings, obs_encoder_t* encoder)
+{
+	// Created directly, as libOBS only creates encoder instances for outputs which are about to start.
+	auto instance = std::make_unique<T>(settings, encoder, false);
+
+	frame_buffer buffer;
+	allocate(buffer, *res.fmt);
+	for (uint32_t frame = 0; frame < ST_FRAMES; frame++) {
+		if (streamfx::benchmark::is_cancelled()) {
+			throw std::runtime_error("Cancelled.");
+		}
+
+		fill(buffer, res.kind, frame);
+		buffer.frame.pts = int64_t(frame) * ST_FPS_DEN;
+
+		encoder_packet packet   = {};
+		bool           received = false;
+		auto           start    = std::chrono::steady_clock::now();
+		if (!instance->encode_video(&buffer.frame, &packet, &received)) {
+			throw std::runtime_error("Encoding failed.");
+		}
+		res.total->track(std::chrono::steady_clock::now() - start);
+
+		if (received) {
+			// Packets carry the timestamp of the frame they belong to.
+			uint64_t latency =
+				static_cast<uint64_t>(std::max<int64_t>(buffer.frame.pts - packet.pts, 0) / ST_FPS_DEN);
+			res.packets++;
+			res.latency_total += latency;
+			res.latency_max = std::max(res.latency_max, latency);
+		}
+	}
+
+	check_latency(instance.get(), res);
+
+	res.copy    = instance->get_profiler_copy();
+	res.convert = get_profiler_convert(instance.get());
+	res.encode  = instance->get_profiler_encode();
+}
+
+static const std::vector<codec> codecs = {
+#ifdef ENABLE_ENCODER_FFMPEG
+	{S_PREFIX "libx264", "libx264", "FFmpeg.Threads", nullptr, &encode<streamfx::encoder::ffmpeg::ffmpeg_instance>},
+	{S_PREFIX "libx264", "libx264 (async)", "FFmpeg.Threads",
+	 [](obs_data_t* data) { obs_data_set_bool(data, "FFmpeg.Async", true); },
+	 &encode<streamfx::encoder::ffmpeg::ffmpeg_instance>},
+#ifdef ENABLE_ENCODER_FFMPEG_PRORES
+	{S_PREFIX "prores_aw", "ProRes", "FFmpeg.Threads", nullptr, &encode<streamfx::encoder::ffmpeg::ffmpeg_instance>},
+	{S_PREFIX "prores_aw", "ProRes (frame-parallel)", "FFmpeg.Threads",
+	 [](obs_data_t* data) { obs_data_set_bool(data, "FFmpeg.FrameParallel", true); },
+	 &encode<streamfx::encoder::ffmpeg::ffmpeg_instance>},
+#endif
+#ifdef ENABLE_ENCODER_FFMPEG_DNXHR
+	{S_PREFIX "dnxhd", "DNxHR", "FFmpeg.Threads", nullptr, &encode<streamfx::encoder::ffmpeg::ffmpeg_instance>},
+	{S_PREFIX "dnxhd", "DNxHR (frame-parallel)", "FFmpeg.Threads",
+	 [](obs_data_t* data) { obs_data_set_bool(data, "FFmpeg.FrameParallel", true); },
+	 &encode<streamfx::encoder::ffmpeg::ffmpeg_instance>},
+#endif
+#endif
+#ifdef ENABLE_ENCODER_AOM_AV1
+	{S_PREFIX "aom-av1", "libaom", "Advanced.Threads",
+	 [](obs_data_t* data) {
+		 // The library default is far too slow for live use.
+		 obs_data_set_int(data, "Encoder.CPUUsage", 8);
+	 },
+	 &encode<streamfx::encoder::aom::av1::aom_av1_instance>},
+#endif
+};
+
+static void measure(result& res)
+{
+	// A private video output, as the one of OBS may use a different format and resolution.
+	video_output_info voi = {};
+	voi.name              = "StreamFX Benchmark";
+	voi.format            = res.fmt->id;
+	voi.fps_num           = ST_FPS_NUM;
+	voi.fps_den           = ST_FPS_DEN;
+	voi.width             = ST_WIDTH;
+	voi.height            = ST_HEIGHT;
+	voi.cache_size        = 1;
+	voi.colorspace        = VIDEO_CS_709;
+	voi.range             = VIDEO_RANGE_PARTIAL;
+
+	video_t* video = nullptr;
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS) {
+		throw std::runtime_error("Failed to create video output.");
+	}
+	std::shared_ptr<video_t> video_ptr(video, video_output_close);
+
+	std::shared_ptr<obs_data_t> settings(obs_encoder_defaults(res.test->id), streamfx::obs::obs_data_deleter);
+	if (!settings) {
+		throw std::runtime_error("Encoder is not available.");
+	}
+	if (res.test->configure) {
+		res.test->configure(settings.get());
+	}
+	obs_data_set_int(settings.get(), res.test->threads_key, res.threads);
+
+	// Never started, it only tells the encoder instance about the video it will receive.
+	std::shared_ptr<obs_encoder_t> encoder(
+		obs_video_encoder_create(res.test->id, "StreamFX Benchmark Encoder", settings.get(), nullptr),
+		obs_encoder_release);
+	if (!encoder) {
+		throw std::runtime_error("Failed to create encoder.");
+	}
+	obs_encoder_set_video(encoder.get(), video);
+
+	res.test->run(res, settings.get(), encoder.get());
+}
+
+static void write(std::ostream& stream, std::shared_ptr<streamfx::util::profiler> profiler)
+{
+	auto us = [](std::chrono::nanoseconds value) { return double_t(value.count()) / 1000.; };
+	if (!profiler || (profiler->count() == 0)) {
+		stream << "null";
+		return;
+	}
+	stream << "{\"count\":" << profiler->count() << ",\"avg\":" << (profiler->average_duration() / 1000.)
+		   << ",\"p50\":" << us(profiler->percentile(0.50)) << ",\"p95\":" << us(profiler->percentile(0.95))
+		   << ",\"p99\":" << us(profiler->percentile(0.99)) << ",\"max\":" << us(profiler->maximum()) << "}";
+}
+
+static double_t frames_per_second(const result& res)
+{
+	double_t average = res.total->average_duration();
+	return (average > 0.) ? (1000000000. / average) : 0.;
+}
+
+static double_t average_latency(const result& res)
+{
+	return (res.packets > 0) ? (double_t(res.latency_total) / double_t(res.packets)) : 0.;
+}
+
+void streamfx::benchmark::run_encoders(std::filesystem::path output)
+{
+	if (_running.exchange(true)) {
+		D_LOG_WARNING("Benchmark is already running.", "");
+		return;
+	}
+
+	std::vector<result> results;
+	D_LOG_INFO("Starting encoder benchmark...", "");
+	for (auto& test : codecs) {
+		for (auto& fmt : formats) {
+			for (auto& kind : patterns) {
+				for (auto threads : thread_counts) {
+					if (streamfx::benchmark::is_cancelled()) {
+						break;
+					}
+
+					result res{&test,   &fmt,    kind.first, kind.second, threads, 0, 0, 0,
+							   nullptr, nullptr, nullptr,    streamfx::util::profiler::create()};
+					try {
+						measure(res);
+						results.push_back(res);
+						D_LOG_INFO("%s (%s, %s, %" PRId64 " threads): %.1f fps, %.1f frames latency", test.name,
+								   fmt.name, kind.second, threads, frames_per_second(res), average_latency(res));
+					} catch (const std::exception& ex) {
+						D_LOG_WARNING("Skipping %s (%s, %s, %" PRId64 " threads): %s", test.name, fmt.name,
+									  kind.second, threads, ex.what());
+					}
+				}
+			}
+		}
+	}
+
+	if (streamfx::benchmark::is_cancelled()) {
+		D_LOG_WARNING("Encoder benchmark was cancelled, no results were saved.", "");
+		_running.store(false);
+		return;
+	}
+
+	try {
+		std::error_code ec;
+		if (output.has_parent_path()) {
+			std::filesystem::create_directories(output.parent_path(), ec);
+		}
+
+		std::ofstream stream(output, std::ios::out | std::ios::trunc);
+		if (!stream) {
+			throw std::runtime_error("Failed to open file for writing.");
+		}
+
+		// Times are in microseconds, latency is in frames.
+		stream << std::fixed << std::setprecision(3);
+		stream << "{\"version\":\"" STREAMFX_VERSION_STRING "\",\"cores\":" << std::thread::hardware_concurrency()
+			   << ",\"width\":" << ST_WIDTH << ",\"height\":" << ST_HEIGHT << ",\"frames\":" << ST_FRAMES
+			   << ",\"results\":[";
+		for (std::size_t idx = 0; idx < results.size(); idx++) {
+			auto& res = results[idx];
+			stream << ((idx == 0) ? "" : ",") << "\n{\"codec\":\"" << res.test->name << "\",\"format\":\""
+				   << res.fmt->name << "\",\"pattern\":\"" << res.kind_name << "\",\"threads\":" << res.threads
+				   << ",\"fps\":" << frames_per_second(res) << ",\"packets\":" << res.packets
+				   << ",\"latency\":{\"avg\":" << average_latency(res) << ",\"max\":" << res.latency_max
+				   << "},\"copy\":";
+			write(stream, res.copy);
+			stream << ",\"convert\":";
+			write(stream, res.convert);
+			stream << ",\"encode\":";
+			write(stream, res.encode);
+			stream << ",\"total\":";
+			write(stream, res.total);
+			stream << "}";
+		}
+		stream << "\n]}\n";
+
+		D_LOG_INFO("Saved encoder benchmark results to '%s'.", output.u8string().c_str());
+	} catch (const std::exception& ex) {
+		D_LOG_ERROR("Failed to save encoder benchmark results: %s", ex.what());
+	}
+
+	_running.store(false);
+}
@@ -0,0 +1,32 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <filesystem>
+
+namespace streamfx::benchmark {
+	/** Encode synthetic 1080p frames with every software encoder, input format, content pattern and thread count.
+	 *
+	 * Input copy/conversion time, encode time, packet latency in frames and the resulting frame rate are written to
+	 * 'output' as JSON, so that encoder settings can be chosen per machine. Encoders or formats which are not available
+	 * in this build are skipped. Blocks until done, which may take several minutes.
+	 */
+	void run_encoders(std::filesystem::path output);
+} // namespace streamfx::benchmark
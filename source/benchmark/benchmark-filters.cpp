@@ -0,0 +1,418 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "benchmark-filters.hpp"
+#include "benchmark.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget.hpp"
+#include "obs/obs-source.hpp"
+#include "obs/obs-tools.hpp"
+#include "plugin.hpp"
+#include "util/util-logging.hpp"
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<benchmark::filters> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+// Frames rendered before measuring, so that lazily created resources don't skew the results.
+#define ST_WARMUP_FRAMES 10
+#define ST_MEASURED_FRAMES 120
+#define ST_FRAME_TIME (1.f / 60.f)
+
+// How long to wait for the GPU to deliver the timer queries of a single case.
+#define ST_GPU_TIMEOUT std::chrono::seconds(10)
+
+// Every parameter of an effect is looked up this many times, which is enough to be measurable.
+#define ST_LOOKUP_ROUNDS 1000
+
+struct variant {
+	const char*                      filter;
+	const char*                      name;
+	std::function<void(obs_data_t*)> configure;
+};
+
+static std::function<void(obs_data_t*)> blur(const char* type, const char* subtype)
+{
+	return [type, subtype](obs_data_t* data) {
+		obs_data_set_string(data, "Filter.Blur.Type", type);
+		obs_data_set_string(data, "Filter.Blur.SubType", subtype);
+		obs_data_set_double(data, "Filter.Blur.Size", 15.);
+	};
+}
+
+static const std::vector<variant> variants = {
+	{S_PREFIX "filter-blur", "box/area", blur("box", "area")},
+	{S_PREFIX "filter-blur", "box/directional", blur("box", "directional")},
+	{S_PREFIX "filter-blur", "box/rotational", blur("box", "rotational")},
+	{S_PREFIX "filter-blur", "box/zoom", blur("box", "zoom")},
+	{S_PREFIX "filter-blur", "box_linear/area", blur("box_linear", "area")},
+	{S_PREFIX "filter-blur", "box_linear/directional", blur("box_linear", "directional")},
+	{S_PREFIX "filter-blur", "gaussian/area", blur("gaussian", "area")},
+	{S_PREFIX "filter-blur", "gaussian/directional", blur("gaussian", "directional")},
+	{S_PREFIX "filter-blur", "gaussian/rotational", blur("gaussian", "rotational")},
+	{S_PREFIX "filter-blur", "gaussian/zoom", blur("gaussian", "zoom")},
+	{S_PREFIX "filter-blur", "gaussian_linear/area", blur("gaussian_linear", "area")},
+	{S_PREFIX "filter-blur", "gaussian_linear/directional", blur("gaussian_linear", "directional")},
+	{S_PREFIX "filter-blur", "dual_filtering/area", blur("dual_filtering", "area")},
+	{S_PREFIX "filter-color-grade", "default", nullptr},
+	{S_PREFIX "filter-sdf-effects", "shadow+outline",
+	 [](obs_data_t* data) {
+		 obs_data_set_bool(data, "Filter.SDFEffects.Shadow.Outer", true);
+		 obs_data_set_bool(data, "Filter.SDFEffects.Outline", true);
+	 }},
+	{S_PREFIX "filter-transform", "default", nullptr},
+	{S_PREFIX "filter-dynamic-mask", "default", nullptr},
+	{S_PREFIX "filter-displacement", "default", nullptr},
+	{S_PREFIX "filter-shader", "default", nullptr},
+};
+
+static const char* lookup_effects[] = {
+	"effects/blur/gaussian.effect",
+	"effects/sdf/sdf-consumer.effect",
+	"effects/transform.effect",
+	"effects/color-grade.effect",
+};
+
+static const std::pair<uint32_t, uint32_t> resolutions[] = {
+	{1280, 720},
+	{1920, 1080},
+	{3840, 2160},
+};
+
+struct result {
+	const variant*                            test;
+	uint32_t                                  width;
+	uint32_t                                  height;
+	std::shared_ptr<streamfx::util::profiler> cpu;
+	std::shared_ptr<streamfx::util::profiler> gpu;
+};
+
+struct lookup_result {
+	const char* file;
+	std::size_t parameters;
+	double_t    linear; // Nanoseconds per lookup through libOBS, which compares every name.
+	double_t    hashed; // Nanoseconds per lookup through streamfx::obs::gs::effect.
+};
+
+static std::atomic<bool> _running{false};
+
+// Shared between the benchmark thread and the render callback on the graphics thread.
+struct render_state {
+	result&                                          res;
+	obs_source_t*                                    source;
+	std::shared_ptr<streamfx::obs::gs::rendertarget> rt;
+	std::vector<gs_timer_t*>                         timers;
+	gs_timer_range_t*                                range;
+	std::size_t                                      frame;
+
+	std::mutex              lock;
+	std::condition_variable signal;
+	bool                    done;
+};
+
+static void render_frame(void* ptr, uint32_t, uint32_t)
+{
+	auto& state = *reinterpret_cast<render_state*>(ptr);
+	if (state.frame >= (ST_WARMUP_FRAMES + ST_MEASURED_FRAMES)) {
+		return;
+	}
+
+	bool        measured = (state.frame >= ST_WARMUP_FRAMES);
+	std::size_t idx      = state.frame - (measured ? ST_WARMUP_FRAMES : 0);
+
+	// libOBS ticks the source and filter itself, before rendering, so every frame here is a fresh one.
+	if (measured && (idx == 0) && state.range) {
+		gs_timer_range_begin(state.range);
+	}
+	if (measured && state.timers[idx]) {
+		gs_timer_begin(state.timers[idx]);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		auto op = state.rt->render(state.res.width, state.res.height);
+		vec4 black;
+		vec4_zero(&black);
+		gs_ortho(0, static_cast<float_t>(state.res.width), 0, static_cast<float_t>(state.res.height), -1., 1.);
+		gs_clear(GS_CLEAR_COLOR, &black, 0, 0);
+		obs_source_video_render(state.source);
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	if (measured && state.timers[idx]) {
+		gs_timer_end(state.timers[idx]);
+	}
+	if (measured && (idx == (ST_MEASURED_FRAMES - 1)) && state.range) {
+		gs_timer_range_end(state.range);
+	}
+	if (measured) {
+		state.res.cpu->track(end - start);
+	}
+
+	if (++state.frame >= (ST_WARMUP_FRAMES + ST_MEASURED_FRAMES)) {
+		std::unique_lock<std::mutex> lock(state.lock);
+		state.done = true;
+		state.signal.notify_all();
+	}
+}
+
+static void measure(result& res)
+{
+	// Synthetic input, the cost of these filters does not depend on content.
+	std::shared_ptr<obs_data_t> source_data(obs_data_create(), streamfx::obs::obs_data_deleter);
+	obs_data_set_int(source_data.get(), "width", res.width);
+	obs_data_set_int(source_data.get(), "height", res.height);
+	obs_data_set_int(source_data.get(), "color", 0xFF7F3F1F);
+	streamfx::obs::source source{"color_source_v3", "StreamFX Benchmark Source", source_data.get()};
+
+	std::shared_ptr<obs_data_t> filter_data(obs_data_create(), streamfx::obs::obs_data_deleter);
+	if (res.test->configure) {
+		res.test->configure(filter_data.get());
+	}
+	streamfx::obs::source filter{res.test->filter, "StreamFX Benchmark Filter", filter_data.get()};
+	source.add_filter(filter);
+
+	render_state state{res, source.get(), nullptr, std::vector<gs_timer_t*>(ST_MEASURED_FRAMES, nullptr), nullptr, 0};
+	{
+		auto gctx   = streamfx::obs::gs::context();
+		state.rt    = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
+		state.range = gs_timer_range_create();
+		for (auto& timer : state.timers) {
+			timer = gs_timer_create();
+		}
+	}
+
+	// Sources are only ever ticked and rendered by the graphics thread, so the frames are rendered there too.
+	obs_add_main_render_callback(render_frame, &state);
+	{
+		std::unique_lock<std::mutex> lock(state.lock);
+		while (!state.done && !streamfx::benchmark::is_cancelled()) {
+			state.signal.wait_for(lock, std::chrono::milliseconds(100));
+		}
+	}
+	obs_remove_main_render_callback(render_frame, &state);
+
+	// Benchmarks may wait for the GPU, but only briefly hold the graphics context while doing so.
+	bool     disjoint  = true;
+	uint64_t frequency = 0;
+	for (auto timeout = std::chrono::steady_clock::now() + ST_GPU_TIMEOUT;
+		 state.done && state.range && !streamfx::benchmark::is_cancelled()
+		 && (std::chrono::steady_clock::now() < timeout);) {
+		{
+			auto gctx = streamfx::obs::gs::context();
+			if (gs_timer_range_get_data(state.range, &disjoint, &frequency)) {
+				break;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	{
+		auto gctx = streamfx::obs::gs::context();
+		for (auto timer : state.timers) {
+			uint64_t ticks = 0;
+			if (!disjoint && (frequency > 0) && timer && gs_timer_get_data(timer, &ticks)) {
+				res.gpu->track(std::chrono::nanoseconds(
+					static_cast<int64_t>(static_cast<double_t>(ticks) * 1000000000. / frequency)));
+			}
+			if (timer) {
+				gs_timer_destroy(timer);
+			}
+		}
+		if (state.range) {
+			gs_timer_range_destroy(state.range);
+		}
+		state.rt.reset();
+	}
+
+	source.remove_filter(filter);
+
+	if (!state.done) {
+		throw std::runtime_error("Cancelled.");
+	}
+}
+
+static void measure_lookups(lookup_result& res)
+{
+	auto effect = streamfx::obs::gs::effect::create(streamfx::data_file_path(res.file));
+
+	std::vector<std::string> names;
+	for (std::size_t idx = 0; idx < effect.count_parameters(); idx++) {
+		names.emplace_back(effect.get_parameter(idx).get_name());
+	}
+	res.parameters = names.size();
+	if (names.empty()) {
+		throw std::runtime_error("Effect has no parameters.");
+	}
+
+	// Counting the results keeps the lookups from being optimized away.
+	std::size_t found = 0;
+	auto        start = std::chrono::steady_clock::now();
+	for (std::size_t round = 0; round < ST_LOOKUP_ROUNDS; round++) {
+		for (auto& name : names) {
+			found += gs_effect_get_param_by_name(effect.get_object(), name.c_str()) ? 1 : 0;
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (std::size_t round = 0; round < ST_LOOKUP_ROUNDS; round++) {
+		for (auto& name : names) {
+			found += effect.get_parameter(name) ? 1 : 0;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	double_t lookups = double_t(ST_LOOKUP_ROUNDS * names.size());
+	if (found != (ST_LOOKUP_ROUNDS * names.size() * 2)) {
+		throw std::runtime_error("Not every parameter was found.");
+	}
+	res.linear = double_t(std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count()) / lookups;
+	res.hashed = double_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count()) / lookups;
+}
+
+static void write(std::ostream& stream, std::shared_ptr<streamfx::util::profiler> profiler)
+{
+	auto us = [](std::chrono::nanoseconds value) { return double_t(value.count()) / 1000.; };
+	if (profiler->count() == 0) {
+		stream << "null";
+		return;
+	}
+	stream << "{\"count\":" << profiler->count() << ",\"avg\":" << (profiler->average_duration() / 1000.)
+		   << ",\"p50\":" << us(profiler->percentile(0.50)) << ",\"p95\":" << us(profiler->percentile(0.95))
+		   << ",\"p99\":" << us(profiler->percentile(0.99)) << ",\"max\":" << us(profiler->maximum()) << "}";
+}
+
+void streamfx::benchmark::run_filters(std::filesystem::path output)
+{
+	if (_running.exchange(true)) {
+		D_LOG_WARNING("Benchmark is already running.", "");
+		return;
+	}
+
+	std::vector<result> results;
+	D_LOG_INFO("Starting filter benchmark...", "");
+	for (auto& test : variants) {
+		for (auto& resolution : resolutions) {
+			if (streamfx::benchmark::is_cancelled()) {
+				break;
+			}
+
+			result res{&test, resolution.first, resolution.second, streamfx::util::profiler::create(),
+					   streamfx::util::profiler::create()};
+			try {
+				measure(res);
+				results.push_back(res);
+				D_LOG_INFO("%s (%s) at %" PRIu32 "x%" PRIu32 ": CPU %.3f ms, GPU %.3f ms (median)", test.filter,
+						   test.name, res.width, res.height,
+						   double_t(res.cpu->percentile(0.5).count()) / 1000000.,
+						   double_t(res.gpu->percentile(0.5).count()) / 1000000.);
+			} catch (const std::exception& ex) {
+				D_LOG_WARNING("Skipping %s (%s) at %" PRIu32 "x%" PRIu32 ": %s", test.filter, test.name, res.width,
+							  res.height, ex.what());
+			}
+		}
+	}
+
+	std::vector<lookup_result> lookups;
+	for (auto file : lookup_effects) {
+		if (streamfx::benchmark::is_cancelled()) {
+			break;
+		}
+
+		lookup_result res{file, 0, 0., 0.};
+		try {
+			measure_lookups(res);
+			lookups.push_back(res);
+			D_LOG_INFO("Parameter lookup in '%s' (%zu parameters): %.1f ns linear, %.1f ns hashed", file,
+					   res.parameters, res.linear, res.hashed);
+		} catch (const std::exception& ex) {
+			D_LOG_WARNING("Skipping parameter lookup in '%s': %s", file, ex.what());
+		}
+	}
+
+	if (streamfx::benchmark::is_cancelled()) {
+		D_LOG_WARNING("Filter benchmark was cancelled, no results were saved.", "");
+		_running.store(false);
+		return;
+	}
+
+	try {
+		std::error_code ec;
+		if (output.has_parent_path()) {
+			std::filesystem::create_directories(output.parent_path(), ec);
+		}
+
+		std::ofstream stream(output, std::ios::out | std::ios::trunc);
+		if (!stream) {
+			throw std::runtime_error("Failed to open file for writing.");
+		}
+
+		const char* device = nullptr;
+		{
+			auto gctx = streamfx::obs::gs::context();
+			device    = gs_get_device_name();
+		}
+
+		// Times are in microseconds.
+		stream << std::fixed << std::setprecision(3);
+		stream << "{\"version\":\"" STREAMFX_VERSION_STRING "\",\"device\":\"" << (device ? device : "")
+			   << "\",\"frames\":" << ST_MEASURED_FRAMES << ",\"results\":[";
+		for (std::size_t idx = 0; idx < results.size(); idx++) {
+			auto& res = results[idx];
+			stream << ((idx == 0) ? "" : ",") << "\n{\"filter\":\"" << res.test->filter << "\",\"variant\":\""
+				   << res.test->name << "\",\"width\":" << res.width << ",\"height\":" << res.height << ",\"cpu\":";
+			write(stream, res.cpu);
+			stream << ",\"gpu\":";
+			write(stream, res.gpu);
+			stream << "}";
+		}
+		stream << "\n],\"lookups\":[";
+		for (std::size_t idx = 0; idx < lookups.size(); idx++) {
+			auto& res = lookups[idx];
+			stream << ((idx == 0) ? "" : ",") << "\n{\"effect\":\"" << res.file
+				   << "\",\"parameters\":" << res.parameters << ",\"linear\":" << (res.linear / 1000.)
+				   << ",\"hashed\":" << (res.hashed / 1000.) << "}";
+		}
+		stream << "\n]}\n";
+
+		D_LOG_INFO("Saved filter benchmark results to '%s'.", output.u8string().c_str());
+	} catch (const std::exception& ex) {
+		D_LOG_ERROR("Failed to save filter benchmark results: %s", ex.what());
+	}
+
+	_running.store(false);
+}
@@ -0,0 +1,32 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <filesystem>
+
+namespace streamfx::benchmark {
+	/** Render every filter variant offscreen on synthetic 720p, 1080p and 2160p sources.
+	 *
+	 * Per-frame CPU (submission) and GPU time is written to 'output' as JSON, so that results can be compared between
+	 * builds and machines. Filters which are not available in this build are skipped. The cost of effect parameter
+	 * lookups by name is measured as well. Blocks until done, and must not be called from the graphics thread.
+	 */
+	void run_filters(std::filesystem::path output);
+} // namespace streamfx::benchmark
@@ -0,0 +1,374 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "benchmark-threadpool.hpp"
+#include "benchmark.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "plugin.hpp"
+#include "util/util-logging.hpp"
+#include "util/util-profiler.hpp"
+#include "util/util-threadpool.hpp"
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<benchmark::threadpool> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+// Tasks pushed one at a time, each waited for before the next, to measure how long an idle pool takes to react.
+#define ST_LATENCY_SAMPLES 1000
+
+// Empty tasks pushed in one go, to measure the overhead of the queues themselves.
+#define ST_THROUGHPUT_TASKS 100000
+
+// Items processed by parallel_for, and how often that is repeated per grain size.
+#define ST_PARALLEL_ITEMS (1u << 20)
+#define ST_PARALLEL_ROUNDS 100
+
+static const std::pair<streamfx::util::threadpool_priority, const char*> priorities[] = {
+	{streamfx::util::threadpool_priority::REALTIME, "realtime"},
+	{streamfx::util::threadpool_priority::NORMAL, "normal"},
+	{streamfx::util::threadpool_priority::BACKGROUND, "background"},
+};
+
+static const std::size_t grains[] = {1024, 16384, 262144};
+
+struct priority_result {
+	const char*                               name;
+	std::shared_ptr<streamfx::util::profiler> latency;
+	double_t                                  throughput; // Tasks per second.
+};
+
+struct parallel_result {
+	std::size_t                               grain;
+	std::shared_ptr<streamfx::util::profiler> duration;
+};
+
+static std::atomic<bool> _running{false};
+
+/** The thread pool as it was before priorities and work stealing, kept as the baseline to compare against.
+ *
+ * A single list of tasks behind one mutex, with twice as many workers as there are hardware threads.
+ */
+class legacy_threadpool {
+	public:
+	class task {
+		std::mutex                            _mutex;
+		std::condition_variable               _is_complete;
+		std::atomic<bool>                     _is_dead;
+		streamfx::util::threadpool_callback_t _callback;
+		streamfx::util::threadpool_data_t     _data;
+
+		public:
+		task(streamfx::util::threadpool_callback_t callback_function, streamfx::util::threadpool_data_t data)
+			: _mutex(), _is_complete(), _is_dead(false), _callback(callback_function), _data(data)
+		{}
+
+		void await_completion()
+		{
+			if (!_is_dead) {
+				std::unique_lock<std::mutex> lock(_mutex);
+				_is_complete.wait(lock, [this]() { return _is_dead.load(); });
+			}
+		}
+
+		friend class legacy_threadpool;
+	};
+
+	private:
+	std::list<std::thread>           _workers;
+	std::atomic<bool>                _worker_stop;
+	std::list<std::shared_ptr<task>> _tasks;
+	std::mutex                       _tasks_lock;
+	std::condition_variable          _tasks_cv;
+
+	public:
+	legacy_threadpool() : _workers(), _worker_stop(false), _tasks(), _tasks_lock(), _tasks_cv()
+	{
+		std::size_t concurrency = static_cast<size_t>(std::thread::hardware_concurrency() * 2);
+		for (std::size_t n = 0; n < concurrency; n++) {
+			_workers.emplace_back(&legacy_threadpool::work, this);
+		}
+	}
+
+	~legacy_threadpool()
+	{
+		_worker_stop = true;
+		_tasks_cv.notify_all();
+		for (auto& thread : _workers) {
+			_tasks_cv.notify_all();
+			if (thread.joinable()) {
+				thread.join();
+			}
+		}
+	}
+
+	std::shared_ptr<task> push(streamfx::util::threadpool_callback_t fn, streamfx::util::threadpool_data_t data)
+	{
+		auto work = std::make_shared<task>(fn, data);
+
+		std::unique_lock<std::mutex> lock(_tasks_lock);
+		_tasks.emplace_back(work);
+		_tasks_cv.notify_one();
+
+		return work;
+	}
+
+	std::size_t size()
+	{
+		return _workers.size();
+	}
+
+	private:
+	void work()
+	{
+		std::shared_ptr<task> local_work{};
+		while (!_worker_stop) {
+			{
+				std::unique_lock<std::mutex> lock(_tasks_lock);
+				if (_tasks.size() == 0) {
+					_tasks_cv.wait(lock, [this]() { return _worker_stop || _tasks.size() > 0; });
+				}
+				if (_worker_stop || (_tasks.size() == 0)) {
+					continue;
+				}
+				local_work = _tasks.front();
+				_tasks.pop_front();
+			}
+
+			if (local_work->_is_dead.load()) {
+				continue;
+			}
+
+			if (local_work->_callback) {
+				try {
+					local_work->_callback(local_work->_data);
+				} catch (...) {
+				}
+				{
+					std::unique_lock<std::mutex> lock(local_work->_mutex);
+					local_work->_is_dead.store(true);
+				}
+				local_work->_is_complete.notify_all();
+			}
+			local_work.reset();
+		}
+	}
+};
+
+// Both pools are measured the same way, the legacy pool has no priorities.
+static auto submit(streamfx::util::threadpool& pool, streamfx::util::threadpool_callback_t fn,
+				   streamfx::util::threadpool_priority priority)
+{
+	return pool.push(fn, nullptr, priority);
+}
+
+static auto submit(legacy_threadpool& pool, streamfx::util::threadpool_callback_t fn,
+				   streamfx::util::threadpool_priority)
+{
+	return pool.push(fn, nullptr);
+}
+
+template<typename T>
+static void measure_latency(T& pool, streamfx::util::threadpool_priority priority, priority_result& res)
+{
+	for (std::size_t idx = 0; idx < ST_LATENCY_SAMPLES; idx++) {
+		if (streamfx::benchmark::is_cancelled()) {
+			throw std::runtime_error("Cancelled.");
+		}
+
+		std::chrono::steady_clock::time_point started;
+		auto record = [&started](streamfx::util::threadpool_data_t) { started = std::chrono::steady_clock::now(); };
+
+		auto pushed = std::chrono::steady_clock::now();
+		submit(pool, record, priority)->await_completion();
+		res.latency->track(started - pushed);
+	}
+}
+
+template<typename T>
+static void measure_throughput(T& pool, streamfx::util::threadpool_priority priority, priority_result& res)
+{
+	std::atomic<std::size_t>                               executed{0};
+	std::vector<decltype(submit(pool, nullptr, priority))> tasks;
+	tasks.reserve(ST_THROUGHPUT_TASKS);
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t idx = 0; idx < ST_THROUGHPUT_TASKS; idx++) {
+		tasks.push_back(
+			submit(pool, [&executed](streamfx::util::threadpool_data_t) { executed.fetch_add(1); }, priority));
+	}
+	for (auto& task : tasks) {
+		task->await_completion();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	if (executed.load() != ST_THROUGHPUT_TASKS) {
+		throw std::runtime_error("Not every task was executed.");
+	}
+	auto seconds   = std::chrono::duration_cast<std::chrono::duration<double_t>>(end - start).count();
+	res.throughput = double_t(ST_THROUGHPUT_TASKS) / seconds;
+}
+
+static void measure_parallel(streamfx::util::threadpool& pool, parallel_result& res)
+{
+	// Some actual work per item, so that the result can't be optimized away.
+	std::vector<uint32_t> items(ST_PARALLEL_ITEMS, 1);
+	for (std::size_t round = 0; round < ST_PARALLEL_ROUNDS; round++) {
+		if (streamfx::benchmark::is_cancelled()) {
+			throw std::runtime_error("Cancelled.");
+		}
+
+		std::atomic<uint64_t> sum{0};
+		auto                  start = std::chrono::steady_clock::now();
+		pool.parallel_for(0, items.size(), res.grain, [&items, &sum](std::size_t begin, std::size_t end) {
+			uint64_t local = 0;
+			for (std::size_t idx = begin; idx < end; idx++) {
+				local += items[idx];
+			}
+			sum.fetch_add(local);
+		});
+		res.duration->track(std::chrono::steady_clock::now() - start);
+
+		if (sum.load() != items.size()) {
+			throw std::runtime_error("Not every item was processed.");
+		}
+	}
+}
+
+static void write(std::ostream& stream, std::shared_ptr<streamfx::util::profiler> profiler)
+{
+	auto us = [](std::chrono::nanoseconds value) { return double_t(value.count()) / 1000.; };
+	if (!profiler || (profiler->count() == 0)) {
+		stream << "null";
+		return;
+	}
+	stream << "{\"count\":" << profiler->count() << ",\"avg\":" << (profiler->average_duration() / 1000.)
+		   << ",\"p50\":" << us(profiler->percentile(0.50)) << ",\"p95\":" << us(profiler->percentile(0.95))
+		   << ",\"p99\":" << us(profiler->percentile(0.99)) << ",\"max\":" << us(profiler->maximum()) << "}";
+}
+
+void streamfx::benchmark::run_threadpool(std::filesystem::path output)
+{
+	if (_running.exchange(true)) {
+		D_LOG_WARNING("Benchmark is already running.", "");
+		return;
+	}
+
+	// Same size and limits as the shared pool, which is what everything else runs on.
+	auto                       shared = streamfx::threadpool();
+	streamfx::util::threadpool pool{shared ? shared->size() : 0};
+	if (shared) {
+		for (auto& priority : priorities) {
+			pool.limit(priority.first, shared->limit(priority.first));
+		}
+	}
+
+	std::vector<priority_result> results;
+	std::vector<parallel_result> parallel;
+	priority_result              legacy{"legacy", nullptr, 0.};
+	std::size_t                  legacy_workers = 0;
+	D_LOG_INFO("Starting thread pool benchmark with %zu workers...", pool.size());
+	try {
+		for (auto& priority : priorities) {
+			priority_result res{priority.second, streamfx::util::profiler::create(), 0.};
+			measure_latency(pool, priority.first, res);
+			measure_throughput(pool, priority.first, res);
+			results.push_back(res);
+			D_LOG_INFO("%s: %.1f us latency (median), %.0f tasks per second", res.name,
+					   double_t(res.latency->percentile(0.5).count()) / 1000., res.throughput);
+		}
+
+		{
+			legacy_threadpool baseline;
+			legacy.latency = streamfx::util::profiler::create();
+			legacy_workers = baseline.size();
+			measure_latency(baseline, streamfx::util::threadpool_priority::NORMAL, legacy);
+			measure_throughput(baseline, streamfx::util::threadpool_priority::NORMAL, legacy);
+			D_LOG_INFO("%s: %.1f us latency (median), %.0f tasks per second, %zu workers", legacy.name,
+					   double_t(legacy.latency->percentile(0.5).count()) / 1000., legacy.throughput, legacy_workers);
+		}
+
+		for (auto grain : grains) {
+			parallel_result res{grain, streamfx::util::profiler::create()};
+			measure_parallel(pool, res);
+			parallel.push_back(res);
+			D_LOG_INFO("parallel_for with a grain of %zu: %.3f ms (median)", grain,
+					   double_t(res.duration->percentile(0.5).count()) / 1000000.);
+		}
+	} catch (const std::exception& ex) {
+		D_LOG_WARNING("Thread pool benchmark stopped, no results were saved: %s", ex.what());
+		_running.store(false);
+		return;
+	}
+
+	try {
+		std::error_code ec;
+		if (output.has_parent_path()) {
+			std::filesystem::create_directories(output.parent_path(), ec);
+		}
+
+		std::ofstream stream(output, std::ios::out | std::ios::trunc);
+		if (!stream) {
+			throw std::runtime_error("Failed to open file for writing.");
+		}
+
+		// Times are in microseconds.
+		stream << std::fixed << std::setprecision(3);
+		stream << "{\"version\":\"" STREAMFX_VERSION_STRING "\",\"cores\":" << std::thread::hardware_concurrency()
+			   << ",\"workers\":" << pool.size() << ",\"items\":" << ST_PARALLEL_ITEMS << ",\"priorities\":[";
+		for (std::size_t idx = 0; idx < results.size(); idx++) {
+			auto& res = results[idx];
+			stream << ((idx == 0) ? "" : ",") << "\n{\"priority\":\"" << res.name << "\",\"latency\":";
+			write(stream, res.latency);
+			stream << ",\"throughput\":" << res.throughput << "}";
+		}
+		stream << "\n],\"legacy\":{\"workers\":" << legacy_workers << ",\"latency\":";
+		write(stream, legacy.latency);
+		stream << ",\"throughput\":" << legacy.throughput << "},\"parallel_for\":[";
+		for (std::size_t idx = 0; idx < parallel.size(); idx++) {
+			auto& res = parallel[idx];
+			stream << ((idx == 0) ? "" : ",") << "\n{\"grain\":" << res.grain << ",\"duration\":";
+			write(stream, res.duration);
+			stream << "}";
+		}
+		stream << "\n]}\n";
+
+		D_LOG_INFO("Saved thread pool benchmark results to '%s'.", output.u8string().c_str());
+	} catch (const std::exception& ex) {
+		D_LOG_ERROR("Failed to save thread pool benchmark results: %s", ex.what());
+	}
+
+	_running.store(false);
+}
@@ -0,0 +1,33 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <filesystem>
+
+namespace streamfx::benchmark {
+	/** Measure how quickly the thread pool starts and finishes work, for every priority class.
+	 *
+	 * Latency from push to execution on an idle pool, throughput of empty tasks pushed from outside of the pool and the
+	 * time taken by parallel_for at several grain sizes are written to 'output' as JSON. Uses a private pool of the
+	 * same size as the shared one, so that the plugin's own work does not skew the results. Latency and throughput are
+	 * also measured on a copy of the previous single-queue pool, as the baseline to compare against. Blocks until done.
+	 */
+	void run_threadpool(std::filesystem::path output);
+} // namespace streamfx::benchmark
@@ -0,0 +1,82 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "benchmark.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "util/util-logging.hpp"
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<benchmark> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+static std::mutex        _lock;
+static std::thread       _thread;
+static std::atomic<bool> _busy{false};
+static std::atomic<bool> _cancelled{false};
+
+void streamfx::benchmark::run(std::function<void()> task)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	if (_cancelled.load() || _busy.exchange(true)) {
+		D_LOG_WARNING("A benchmark is already running.", "");
+		return;
+	}
+
+	// The previous thread has finished, it only needs to be joined.
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+
+	_thread = std::thread([task]() {
+		try {
+			task();
+		} catch (const std::exception& ex) {
+			D_LOG_ERROR("Benchmark failed: %s", ex.what());
+		} catch (...) {
+			D_LOG_ERROR("Benchmark failed.", "");
+		}
+		_busy.store(false);
+	});
+}
+
+bool streamfx::benchmark::is_cancelled()
+{
+	return _cancelled.load(std::memory_order_relaxed);
+}
+
+void streamfx::benchmark::finalize()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_cancelled.store(true);
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
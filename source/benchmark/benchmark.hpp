@@ -0,0 +1,40 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <functional>
+
+namespace streamfx::benchmark {
+	/** Run benchmarks on a thread of their own.
+	 *
+	 * Benchmarks take minutes, and would otherwise occupy a thread pool worker for all of that time. Only one task
+	 * runs at a time, later tasks are ignored while one is running.
+	 */
+	void run(std::function<void()> task);
+
+	/** Check if benchmarks should stop early. Benchmarks check this once per frame. */
+	bool is_cancelled();
+
+	/** Cancel the running benchmark and wait for it to stop.
+	 *
+	 * Must be called before anything a benchmark uses is finalized.
+	 */
+	void finalize();
+} // namespace streamfx::benchmark
@@ -23,8 +23,10 @@
 //--------------------------------------------------------------------------------//
 
 #include "encoder-aom-av1.hpp"
+#include <algorithm>
 #include <filesystem>
 #include <thread>
+#include "plugin.hpp"
 #include "util/util-logging.hpp"
 
 #ifdef _DEBUG
@@ -64,6 +66,10 @@
 #define ST_I18N_ENCODER_CPUUSAGE_9 ST_I18N_ENCODER ".CPUUsage.9"
 #define ST_I18N_ENCODER_CPUUSAGE_10 ST_I18N_ENCODER ".CPUUsage.10"
 #define ST_KEY_ENCODER_CPUUSAGE "Encoder.CPUUsage"
+#define ST_I18N_ENCODER_CPUUSAGE_ADAPTIVE ST_I18N_ENCODER_CPUUSAGE ".Adaptive"
+#define ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE "Encoder.CPUUsage.Adaptive"
+#define ST_I18N_ENCODER_CPUUSAGE_ADAPTIVE_TARGET ST_I18N_ENCODER_CPUUSAGE_ADAPTIVE ".Target"
+#define ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE_TARGET "Encoder.CPUUsage.Adaptive.Target"
 #define ST_KEY_ENCODER_PROFILE "Encoder.Profile"
 
 // Rate Control
@@ -132,6 +138,13 @@
 #define ST_I18N_ADVANCED_TUNE_CONTENT_FILM ST_I18N_ADVANCED_TUNE_CONTENT ".Film"
 #define ST_KEY_ADVANCED_TUNE_CONTENT "Advanced.Tune.Content"
 
+// Adaptive CPU Usage
+#define ST_ADAPTIVE_HYSTERESIS 0.75    // Only slow down below this share of the target load.
+#define ST_ADAPTIVE_PATIENCE 4         // Calm windows required before slowing down.
+#define ST_ADAPTIVE_PATIENCE_MAX 64    // Upper limit for the above after repeated oscillation.
+#define ST_ADAPTIVE_PATIENCE_DECAY 60  // Windows without speeding up before the above is halved again.
+#define ST_ADAPTIVE_DEFAULT_CPUUSAGE 5 // Used if the user did not pick a CPU Usage.
+
 using namespace streamfx::encoder::aom::av1;
 
 static constexpr std::string_view HELP_URL = "https://github.com/Xaymar/obs-StreamFX/wiki/Encoder-AOM-AV1";
@@ -310,7 +323,9 @@ const char* aom_tune_content_to_string(aom_tune_content tune)
 
 aom_av1_instance::aom_av1_instance(obs_data_t* settings, obs_encoder_t* self, bool is_hw)
 	: obs::encoder_instance(settings, self, is_hw), _factory(aom_av1_factory::get()), _iface(nullptr), _ctx(), _cfg(),
-	  _image_index(0), _images(), _global_headers(nullptr), _initialized(false), _settings()
+	  _image_index(0), _images(), _image_wrapped(), _global_headers(nullptr), _packets(), _packet_buffers(), _packet_current(),
+	  _packets_peak(0), _packets_pending(), _packets_latency_total(0), _packets_latency_max(0), _packets_sent(0),
+	  _initialized(false), _settings(), _adaptive()
 {
 	if (is_hw) {
 		throw std::runtime_error("Hardware encoding isn't even registered, how did you get here?");
@@ -566,25 +581,12 @@ aom_av1_instance::aom_av1_instance(obs_data_t* settings, obs_encoder_t* self, bo
 	// Preallocate global headers.
 	_global_headers = _factory->libaom_codec_get_global_headers(&_ctx);
 
-	// Allocate frames.
-	_images.resize(_cfg.g_threads);
+	// Allocate frames, used only if the frames from OBS can't be wrapped. libaom copies the image into its own
+	// lookahead buffers during aom_codec_encode, so a small ring is enough to cover all threads.
+	_images.resize(std::max<std::size_t>(_cfg.g_threads, 1));
 	for (auto& image : _images) {
 		_factory->libaom_img_alloc(&image, _settings.color_format, _settings.width, _settings.height, 8);
-
-		// Color Information.
-		image.fmt        = _settings.color_format;
-		image.cp         = _settings.color_primaries;
-		image.tc         = _settings.color_trc;
-		image.mc         = _settings.color_matrix;
-		image.range      = _settings.color_range;
-		image.monochrome = _settings.monochrome ? 1 : 0;
-		image.csp        = AOM_CSP_VERTICAL; // !TODO: Consider making this user-controlled.
-
-		// Size
-		image.r_w = image.d_w;
-		image.r_h = image.d_h;
-		image.r_w = image.w;
-		image.r_h = image.h;
+		apply_image_info(image);
 	}
 
 	// Log Settings
@@ -620,6 +622,14 @@ aom_av1_instance::~aom_av1_instance()
 			   _profiler_packet->count());
 #endif
 
+	// Flush the encoder, so that all of its work is done before anything is freed.
+	flush_packets();
+	if (_packets_sent > 0) {
+		auto latency = get_packet_latency();
+		D_LOG_INFO("Packets: Peak Queue=%zu, Avg. Latency=%.2f frames, Max. Latency=%" PRIu64 " frames",
+				   _packets_peak, latency.first, latency.second);
+	}
+
 	// Deallocate global buffer.
 	if (_global_headers) {
 		/* Breaks heap
@@ -661,6 +671,9 @@ bool aom_av1_instance::update(obs_data_t* settings)
 
 		{ // Encoder
 			_settings.preset = static_cast<int8_t>(obs_data_get_int(settings, ST_KEY_ENCODER_CPUUSAGE));
+			_adaptive.enabled = obs_data_get_bool(settings, ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE);
+			_adaptive.target =
+				static_cast<double>(obs_data_get_int(settings, ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE_TARGET)) / 100.;
 		}
 
 		{ // Rate Control
@@ -827,6 +840,22 @@ bool aom_av1_instance::update(obs_data_t* settings)
 					);
 				}
 			}
+
+			// Restart the adaptive controller from the slowest level the user allows.
+			_adaptive.maximum  = (_cfg.g_usage == AOM_USAGE_REALTIME) ? 10 : 9;
+			_adaptive.minimum  = (_settings.preset != -1) ? _settings.preset : int8_t(ST_ADAPTIVE_DEFAULT_CPUUSAGE);
+			_adaptive.minimum  = std::min(_adaptive.minimum, _adaptive.maximum);
+			_adaptive.level    = _adaptive.minimum;
+			_adaptive.window   = std::max<uint32_t>(_settings.fps.num / std::max<uint32_t>(_settings.fps.den, 1), 10);
+			_adaptive.frames   = 0;
+			_adaptive.elapsed  = std::chrono::nanoseconds(0);
+			_adaptive.calm     = 0;
+			_adaptive.patience = ST_ADAPTIVE_PATIENCE;
+			_adaptive.stable   = 0;
+			_adaptive.slowed   = false;
+			if (_adaptive.enabled && (_settings.preset == -1)) {
+				_factory->libaom_codec_control(&_ctx, AOME_SET_CPUUSED, _adaptive.level);
+			}
 #endif
 		}
 
@@ -955,6 +984,12 @@ void aom_av1_instance::log()
 			   aom_color_trc_to_string(_settings.color_trc),
 			   _settings.color_range == AOM_CR_FULL_RANGE ? "Full" : "Partial",
 			   _settings.monochrome ? "/Monochrome" : "");
+	if (_adaptive.enabled) {
+		D_LOG_INFO("  CPU Usage: Adaptive (%" PRId8 " - %" PRId8 ", %1.0f%% target load)", _adaptive.minimum,
+				   _adaptive.maximum, _adaptive.target * 100.);
+	} else {
+		D_LOG_INFO("  CPU Usage: %" PRId8, _settings.preset);
+	}
 
 	// Rate Control
 	D_LOG_INFO("  Rate Control: %s", aom_rc_mode_to_string(_settings.rc_mode));
@@ -1056,130 +1091,365 @@ void aom_av1_instance::get_video_info(struct video_scale_info* info)
 bool streamfx::encoder::aom::av1::aom_av1_instance::encode_video(encoder_frame* frame, encoder_packet* packet,
 																 bool* received_packet)
 {
-	// Retrieve current indexed image.
-	auto& image = _images.at(_image_index);
+	aom_image_t* image = nullptr;
 
-	{ // Copy Image data.
+	{ // Wrap or copy Image data.
 #ifdef ENABLE_PROFILING
 		auto profile = _profiler_copy->track();
 #endif
-		std::memcpy(image.planes[AOM_PLANE_Y], frame->data[0], frame->linesize[0] * image.h);
-		if (image.fmt == AOM_IMG_FMT_I420) {
-			std::memcpy(image.planes[AOM_PLANE_U], frame->data[1], frame->linesize[1] * image.h / 2);
-			std::memcpy(image.planes[AOM_PLANE_V], frame->data[2], frame->linesize[2] * image.h / 2);
+		if (wrap_frame(frame)) {
+			image = &_image_wrapped;
 		} else {
-			std::memcpy(image.planes[AOM_PLANE_U], frame->data[1], frame->linesize[1] * image.h);
-			std::memcpy(image.planes[AOM_PLANE_V], frame->data[2], frame->linesize[2] * image.h);
+			// Retrieve current indexed image, and advance the ring.
+			image        = &_images.at(_image_index);
+			_image_index = (_image_index + 1) % _images.size();
+
+			for (std::size_t plane = AOM_PLANE_Y; plane <= AOM_PLANE_V; plane++) {
+				std::size_t height = image->h;
+				if ((plane != AOM_PLANE_Y) && (image->fmt == AOM_IMG_FMT_I420)) {
+					height /= 2;
+				}
+
+				std::size_t ls_in  = static_cast<std::size_t>(frame->linesize[plane]);
+				std::size_t ls_out = static_cast<std::size_t>(image->stride[plane]);
+				std::size_t bytes  = std::min(ls_in, ls_out);
+				uint8_t*    to     = image->planes[plane];
+				uint8_t*    from   = frame->data[plane];
+
+				// Split the plane into bands of rows, and copy those in parallel.
+				auto copy_rows = [to, from, ls_in, ls_out, bytes](std::size_t begin, std::size_t end) {
+					if (ls_in == ls_out) {
+						std::memcpy(to + ls_out * begin, from + ls_in * begin, ls_in * (end - begin));
+					} else {
+						for (std::size_t y = begin; y < end; y++) {
+							std::memcpy(to + ls_out * y, from + ls_in * y, bytes);
+						}
+					}
+				};
+				streamfx::threadpool()->parallel_rows(height, bytes, copy_rows);
+			}
 		}
 	}
 
 	{ // Try to encode the new image.
-#ifdef ENABLE_PROFILING
-		auto profile = _profiler_encode->track();
-#endif
+		auto                  start = std::chrono::high_resolution_clock::now();
 		aom_enc_frame_flags_t flags = 0;
 		if (_cfg.g_usage == AOM_USAGE_ALL_INTRA) {
 			flags = AOM_EFLAG_FORCE_KF;
 		}
-		if (auto error = _factory->libaom_codec_encode(&_ctx, &image, frame->pts, 1, flags); error != AOM_CODEC_OK) {
+		if (auto error = _factory->libaom_codec_encode(&_ctx, image, frame->pts, 1, flags); error != AOM_CODEC_OK) {
 			const char* errstr = _factory->libaom_codec_err_to_string(error);
 			D_LOG_ERROR("Encoding frame failed with error: %s (code %" PRIu32 ")\n%s\n%s", errstr, error,
 						_factory->libaom_codec_error(&_ctx), _factory->libaom_codec_error_detail(&_ctx));
 			return false;
-		} else {
-			// Increment the image index.
-			_image_index = (_image_index++) % _images.size();
 		}
+		_packets_pending.push_back(frame->pts);
+
+		auto duration =
+			std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start);
+#ifdef ENABLE_PROFILING
+		_profiler_encode->track(duration);
+#endif
+		adapt_cpuusage(duration);
 	}
 
-	{ // Get Packet
+	{ // Get Packets
 #ifdef ENABLE_PROFILING
 		auto profile = _profiler_packet->track();
 #endif
-		aom_codec_iter_t iter = NULL;
-		for (auto* pkt = _factory->libaom_codec_get_cx_data(&_ctx, &iter); pkt != nullptr;
-			 pkt       = _factory->libaom_codec_get_cx_data(&_ctx, &iter)) {
-#ifdef _DEBUG
-			{
-				const char* kind = "";
-				switch (pkt->kind) {
-				case AOM_CODEC_CX_FRAME_PKT:
-					kind = "Frame";
-					break;
-				case AOM_CODEC_STATS_PKT:
-					kind = "Stats";
-					break;
-				case AOM_CODEC_FPMB_STATS_PKT:
-					kind = "FPMB Stats";
-					break;
-				case AOM_CODEC_PSNR_PKT:
-					kind = "PSNR";
-					break;
-				case AOM_CODEC_CUSTOM_PKT:
-					kind = "Custom";
-					break;
-				}
-				D_LOG_DEBUG("\tPacket: Kind=%s", kind)
-			}
-#endif
+		// libaom may produce several packets per frame, anything left behind here would only be seen after the next
+		// frame, adding a frame of latency every time it happens.
+		queue_packets();
+	}
 
-			if (pkt->kind == AOM_CODEC_CX_FRAME_PKT) {
-				// Status
-				packet->type     = OBS_ENCODER_VIDEO;
-				packet->keyframe = ((pkt->data.frame.flags & AOM_FRAME_IS_KEY) == AOM_FRAME_IS_KEY)
-								   || (_cfg.g_usage == AOM_USAGE_ALL_INTRA);
-				if (packet->keyframe) {
-					//
-					packet->priority      = 3; // OBS_NAL_PRIORITY_HIGHEST
-					packet->drop_priority = 3; // OBS_NAL_PRIORITY_HIGHEST
-				} else if ((pkt->data.frame.flags & AOM_FRAME_IS_DROPPABLE) != AOM_FRAME_IS_DROPPABLE) {
-					// Dropping this frame breaks the bitstream.
-					packet->priority      = 2; // OBS_NAL_PRIORITY_HIGH
-					packet->drop_priority = 3; // OBS_NAL_PRIORITY_HIGHEST
-				} else {
-					// This frame can be dropped at will.
-					packet->priority      = 0; // OBS_NAL_PRIORITY_DISPOSABLE
-					packet->drop_priority = 0; // OBS_NAL_PRIORITY_DISPOSABLE
-				}
+	if (_packets.size() > 0) {
+		auto& pkt = _packets.front();
+
+		// Keep the payload alive until the next call, and recycle the one OBS is done with.
+		if (_packet_current.capacity() > 0) {
+			_packet_current.clear();
+			_packet_buffers.push_back(std::move(_packet_current));
+		}
+		_packet_current = std::move(pkt.data);
 
-				// Data
-				packet->data = static_cast<uint8_t*>(pkt->data.frame.buf);
-				packet->size = pkt->data.frame.sz;
+		// Status
+		packet->type          = OBS_ENCODER_VIDEO;
+		packet->keyframe      = pkt.keyframe;
+		packet->priority      = pkt.priority;
+		packet->drop_priority = pkt.drop_priority;
 
-				// Timestamps
-				//TODO: Temporarily set both to the same until there is a way to figure out actual order.
-				packet->pts = pkt->data.frame.pts;
-				packet->dts = pkt->data.frame.pts;
+		// Data
+		packet->data = _packet_current.data();
+		packet->size = _packet_current.size();
 
-				*received_packet = true;
-			}
+		// Timestamps
+		//TODO: Temporarily set both to the same until there is a way to figure out actual order.
+		packet->pts = pkt.pts;
+		packet->dts = pkt.pts;
 
-			if (*received_packet == true)
-				break;
+		*received_packet = true;
+		_packets.pop_front();
+
+		// Latency in frames. Timestamps advance by the frame duration instead of by one, so count the frames instead.
+		while (!_packets_pending.empty() && (_packets_pending.front() <= packet->pts)) {
+			_packets_pending.pop_front();
 		}
+		uint64_t latency = static_cast<uint64_t>(_packets_pending.size());
+		_packets_latency_total += latency;
+		_packets_latency_max = std::max(_packets_latency_max, latency);
+		_packets_sent++;
 
-		if (!*received_packet) {
-			packet->type = OBS_ENCODER_VIDEO;
-			packet->data = nullptr;
-			packet->size = 0;
-			packet->pts  = -1;
-			packet->dts  = -1;
 #ifdef _DEBUG
-			D_LOG_DEBUG("No Packet", "");
+		D_LOG_DEBUG("Packet: Type=%s PTS=%06" PRId64 " DTS=%06" PRId64 " Size=%016" PRIuPTR " Queued=%zu",
+					packet->keyframe ? "I" : "P", packet->pts, packet->dts, packet->size, _packets.size());
 #endif
-			// Not necessarily an error.
-			//return false;
+	} else {
+		packet->type = OBS_ENCODER_VIDEO;
+		packet->data = nullptr;
+		packet->size = 0;
+		packet->pts  = -1;
+		packet->dts  = -1;
+#ifdef _DEBUG
+		D_LOG_DEBUG("No Packet", "");
+#endif
+		// Not necessarily an error.
+	}
+
+	return true;
+}
+
+void streamfx::encoder::aom::av1::aom_av1_instance::apply_image_info(aom_image_t& image)
+{
+	// Color Information.
+	image.fmt        = _settings.color_format;
+	image.cp         = _settings.color_primaries;
+	image.tc         = _settings.color_trc;
+	image.mc         = _settings.color_matrix;
+	image.range      = _settings.color_range;
+	image.monochrome = _settings.monochrome ? 1 : 0;
+	image.csp        = AOM_CSP_VERTICAL; // !TODO: Consider making this user-controlled.
+
+	// Size
+	image.r_w = image.w;
+	image.r_h = image.h;
+}
+
+bool streamfx::encoder::aom::av1::aom_av1_instance::wrap_frame(encoder_frame* frame)
+{
+	// libaom has a single stride for both chroma planes, and can't deal with missing planes or too small strides.
+	if ((frame->linesize[AOM_PLANE_U] != frame->linesize[AOM_PLANE_V])
+		|| (frame->linesize[AOM_PLANE_Y] < static_cast<uint32_t>(_settings.width))
+		|| (frame->data[AOM_PLANE_Y] == nullptr) || (frame->data[AOM_PLANE_U] == nullptr)
+		|| (frame->data[AOM_PLANE_V] == nullptr)) {
+		return false;
+	}
+
+	// Let libaom fill in the format details, then point it at the planes OBS gave us. The frame only has to stay
+	// valid for the duration of aom_codec_encode, which copies it into the lookahead buffers.
+	if (!_factory->libaom_img_wrap(&_image_wrapped, _settings.color_format, _settings.width, _settings.height, 1,
+								   frame->data[AOM_PLANE_Y])) {
+		return false;
+	}
+	for (std::size_t plane = AOM_PLANE_Y; plane <= AOM_PLANE_V; plane++) {
+		_image_wrapped.planes[plane] = frame->data[plane];
+		_image_wrapped.stride[plane] = static_cast<int>(frame->linesize[plane]);
+	}
+	apply_image_info(_image_wrapped);
+
+	return true;
+}
+
+void streamfx::encoder::aom::av1::aom_av1_instance::adapt_cpuusage(std::chrono::nanoseconds duration)
+{
+#ifdef AOM_CTRL_AOME_SET_CPUUSED
+	if (!_adaptive.enabled) {
+		return;
+	}
+
+	// Only decide once per window, so that single complex frames don't cause a change.
+	_adaptive.elapsed += duration;
+	if (++_adaptive.frames < _adaptive.window) {
+		return;
+	}
+
+	double interval = static_cast<double>(_settings.fps.den) / static_cast<double>(_settings.fps.num);
+	double average  = std::chrono::duration<double>(_adaptive.elapsed).count() / _adaptive.frames;
+	double load     = average / interval;
+	_adaptive.frames  = 0;
+	_adaptive.elapsed = std::chrono::nanoseconds(0);
+
+	int8_t level = _adaptive.level;
+	if (load > _adaptive.target) {
+		// Too slow, speed up right away. If this undoes a slow down, be more careful about the next one.
+		if (_adaptive.slowed) {
+			_adaptive.patience = std::min<uint32_t>(_adaptive.patience * 2, ST_ADAPTIVE_PATIENCE_MAX);
+		}
+		_adaptive.calm   = 0;
+		_adaptive.stable = 0;
+		level            = std::min<int8_t>(level + 1, _adaptive.maximum);
+	} else if (load < (_adaptive.target * ST_ADAPTIVE_HYSTERESIS)) {
+		// Enough headroom, but only slow down once it has been there for a while.
+		if (++_adaptive.calm >= _adaptive.patience) {
+			_adaptive.calm = 0;
+			level          = std::max<int8_t>(level - 1, _adaptive.minimum);
+		}
+	} else {
+		_adaptive.calm = 0;
+	}
+
+	// Oscillation is usually caused by a temporary load, so become less careful again once it has been gone a while.
+	if ((load <= _adaptive.target) && (++_adaptive.stable >= ST_ADAPTIVE_PATIENCE_DECAY)) {
+		_adaptive.stable   = 0;
+		_adaptive.patience = std::max<uint32_t>(_adaptive.patience / 2, ST_ADAPTIVE_PATIENCE);
+	}
+	_adaptive.slowed = (level < _adaptive.level);
+
+	if (level == _adaptive.level) {
+		return;
+	}
+
+	if (auto error = _factory->libaom_codec_control(&_ctx, AOME_SET_CPUUSED, static_cast<int>(level));
+		error != AOM_CODEC_OK) {
+		// Don't try this level again.
+		D_LOG_WARNING("Adaptive CPU Usage: Changing to %" PRId8 " failed: %s", level,
+					  _factory->libaom_codec_err_to_string(error));
+		if (level > _adaptive.level) {
+			_adaptive.maximum = _adaptive.level;
 		} else {
+			_adaptive.minimum = _adaptive.level;
+		}
+		_adaptive.slowed = false;
+		return;
+	}
+
+	D_LOG_INFO("Adaptive CPU Usage: %" PRId8 " -> %" PRId8 ", encoding took %1.2f ms per frame (%1.0f%% of %1.2f ms).",
+			   _adaptive.level, level, average * 1000., load * 100., interval * 1000.);
+	_adaptive.level = level;
+#endif
+}
+
+std::pair<double, uint64_t> streamfx::encoder::aom::av1::aom_av1_instance::get_packet_latency()
+{
+	if (_packets_sent == 0) {
+		return {0., 0};
+	}
+	return {static_cast<double>(_packets_latency_total) / static_cast<double>(_packets_sent), _packets_latency_max};
+}
+
+void streamfx::encoder::aom::av1::aom_av1_instance::queue_packets()
+{
+	aom_codec_iter_t iter = NULL;
+	for (auto* pkt = _factory->libaom_codec_get_cx_data(&_ctx, &iter); pkt != nullptr;
+		 pkt       = _factory->libaom_codec_get_cx_data(&_ctx, &iter)) {
 #ifdef _DEBUG
-			D_LOG_DEBUG("Packet: Type=%s PTS=%06" PRId64 " DTS=%06" PRId64 " Size=%016" PRIuPTR "",
-						packet->keyframe ? "I" : "P", packet->pts, packet->dts, packet->size);
+		{
+			const char* kind = "";
+			switch (pkt->kind) {
+			case AOM_CODEC_CX_FRAME_PKT:
+				kind = "Frame";
+				break;
+			case AOM_CODEC_STATS_PKT:
+				kind = "Stats";
+				break;
+			case AOM_CODEC_FPMB_STATS_PKT:
+				kind = "FPMB Stats";
+				break;
+			case AOM_CODEC_PSNR_PKT:
+				kind = "PSNR";
+				break;
+			case AOM_CODEC_CUSTOM_PKT:
+				kind = "Custom";
+				break;
+			}
+			D_LOG_DEBUG("\tPacket: Kind=%s", kind)
+		}
 #endif
+
+		if (pkt->kind != AOM_CODEC_CX_FRAME_PKT) {
+			continue;
+		}
+
+		packet_t entry;
+
+		// Status
+		entry.keyframe = ((pkt->data.frame.flags & AOM_FRAME_IS_KEY) == AOM_FRAME_IS_KEY)
+						 || (_cfg.g_usage == AOM_USAGE_ALL_INTRA);
+		if (entry.keyframe) {
+			//
+			entry.priority      = 3; // OBS_NAL_PRIORITY_HIGHEST
+			entry.drop_priority = 3; // OBS_NAL_PRIORITY_HIGHEST
+		} else if ((pkt->data.frame.flags & AOM_FRAME_IS_DROPPABLE) != AOM_FRAME_IS_DROPPABLE) {
+			// Dropping this frame breaks the bitstream.
+			entry.priority      = 2; // OBS_NAL_PRIORITY_HIGH
+			entry.drop_priority = 3; // OBS_NAL_PRIORITY_HIGHEST
+		} else {
+			// This frame can be dropped at will.
+			entry.priority      = 0; // OBS_NAL_PRIORITY_DISPOSABLE
+			entry.drop_priority = 0; // OBS_NAL_PRIORITY_DISPOSABLE
 		}
+
+		// Data, which libaom only keeps until the next call into it.
+		if (_packet_buffers.size() > 0) {
+			entry.data = std::move(_packet_buffers.back());
+			_packet_buffers.pop_back();
+		}
+		auto buf = static_cast<const uint8_t*>(pkt->data.frame.buf);
+		entry.data.assign(buf, buf + pkt->data.frame.sz);
+
+		// Timestamps
+		entry.pts = pkt->data.frame.pts;
+
+		_packets.push_back(std::move(entry));
 	}
 
-	return true;
+	_packets_peak = std::max(_packets_peak, _packets.size());
+}
+
+void streamfx::encoder::aom::av1::aom_av1_instance::flush_packets()
+{
+	// Signal end of stream until libaom stops producing data, as it may hold back frames for lookahead.
+	std::size_t discarded = _packets.size();
+	for (bool has_data = true; has_data;) {
+		has_data = false;
+
+		if (_factory->libaom_codec_encode(&_ctx, nullptr, 0, 0, 0) != AOM_CODEC_OK) {
+			break;
+		}
+
+		aom_codec_iter_t iter = NULL;
+		for (auto* pkt = _factory->libaom_codec_get_cx_data(&_ctx, &iter); pkt != nullptr;
+			 pkt       = _factory->libaom_codec_get_cx_data(&_ctx, &iter)) {
+			has_data = true;
+			if (pkt->kind == AOM_CODEC_CX_FRAME_PKT) {
+				discarded++;
+			}
+		}
+	}
+	_packets.clear();
+	_packet_buffers.clear();
+
+	if (discarded > 0) {
+		D_LOG_DEBUG("Discarded %zu packets which OBS no longer accepts.", discarded);
+	}
 }
 
+#ifdef ENABLE_PROFILING
+std::shared_ptr<streamfx::util::profiler> streamfx::encoder::aom::av1::aom_av1_instance::get_profiler_copy()
+{
+	return _profiler_copy;
+}
+
+std::shared_ptr<streamfx::util::profiler> streamfx::encoder::aom::av1::aom_av1_instance::get_profiler_encode()
+{
+	return _profiler_encode;
+}
+
+std::shared_ptr<streamfx::util::profiler> streamfx::encoder::aom::av1::aom_av1_instance::get_profiler_packet()
+{
+	return _profiler_packet;
+}
+#endif
+
 aom_av1_factory::aom_av1_factory()
 {
 	// Try and load the AOM library.
@@ -1311,6 +1581,8 @@ void aom_av1_factory::get_defaults2(obs_data_t* settings)
 	{ // Presets
 		obs_data_set_default_int(settings, ST_KEY_ENCODER_USAGE, static_cast<long long>(AOM_USAGE_REALTIME));
 		obs_data_set_default_int(settings, ST_KEY_ENCODER_CPUUSAGE, -1);
+		obs_data_set_default_bool(settings, ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE, false);
+		obs_data_set_default_int(settings, ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE_TARGET, 80);
 		obs_data_set_default_int(settings, ST_KEY_ENCODER_PROFILE,
 								 static_cast<long long>(codec::av1::profile::UNKNOWN));
 	}
@@ -1478,6 +1750,17 @@ obs_properties_t* aom_av1_factory::get_properties2(instance_t* data)
 			obs_property_list_add_int(p, D_TRANSLATE(ST_I18N_ENCODER_CPUUSAGE_1), 1);
 			obs_property_list_add_int(p, D_TRANSLATE(ST_I18N_ENCODER_CPUUSAGE_0), 0);
 		}
+
+		{ // Adaptive CPU Usage
+			auto p = obs_properties_add_bool(grp, ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE,
+											 D_TRANSLATE(ST_I18N_ENCODER_CPUUSAGE_ADAPTIVE));
+		}
+
+		{ // Adaptive CPU Usage Target
+			auto p = obs_properties_add_int_slider(grp, ST_KEY_ENCODER_CPUUSAGE_ADAPTIVE_TARGET,
+												   D_TRANSLATE(ST_I18N_ENCODER_CPUUSAGE_ADAPTIVE_TARGET), 25, 100, 1);
+			obs_property_int_set_suffix(p, " %");
+		}
 #endif
 
 		{ // Profile
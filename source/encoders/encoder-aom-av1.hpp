@@ -24,8 +24,11 @@
 
 #pragma once
 #include "common.hpp"
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <queue>
+#include <vector>
 #include "encoders/codecs/av1.hpp"
 #include "obs/obs-encoder-factory.hpp"
 #include "util/util-library.hpp"
@@ -44,8 +47,26 @@ namespace streamfx::encoder::aom::av1 {
 		aom_codec_enc_cfg_t      _cfg;
 		size_t                   _image_index;
 		std::vector<aom_image_t> _images;
+		aom_image_t              _image_wrapped; // Points at the frame from OBS, owns no memory.
 		aom_fixed_buf_t*         _global_headers;
 
+		// Packets which libaom produced but OBS has not taken yet, oldest first.
+		struct packet_t {
+			std::vector<uint8_t> data;
+			int64_t              pts;
+			bool                 keyframe;
+			int                  priority;
+			int                  drop_priority;
+		};
+		std::deque<packet_t>              _packets;
+		std::vector<std::vector<uint8_t>> _packet_buffers; // Recycled payload buffers.
+		std::vector<uint8_t>              _packet_current; // Handed to OBS, valid until the next call.
+		std::size_t                       _packets_peak;
+		std::deque<int64_t>               _packets_pending;       // Timestamps of frames which have no packet yet.
+		uint64_t                          _packets_latency_total; // In frames.
+		uint64_t                          _packets_latency_max;   // In frames.
+		uint64_t                          _packets_sent;
+
 		bool _initialized;
 		struct {
 			// Video (All Static)
@@ -95,6 +116,22 @@ namespace streamfx::encoder::aom::av1 {
 			aom_tune_content tune_content;
 		} _settings;
 
+		// Adaptive CPU Usage, see adapt_cpuusage().
+		struct {
+			bool                     enabled;
+			double                   target;   // Share of the frame interval that encoding may take.
+			int8_t                   minimum;  // Slowest level, as chosen by the user.
+			int8_t                   maximum;  // Fastest level.
+			int8_t                   level;    // Current level.
+			uint32_t                 window;   // Frames per decision.
+			uint32_t                 frames;   // Frames in the current window.
+			std::chrono::nanoseconds elapsed;  // Encode time in the current window.
+			uint32_t                 calm;     // Consecutive windows with enough headroom.
+			uint32_t                 patience; // Calm windows required before slowing down.
+			uint32_t                 stable;   // Consecutive windows which did not have to speed up.
+			bool                     slowed;   // Whether the last window slowed down.
+		} _adaptive;
+
 #ifdef ENABLE_PROFILING
 		std::shared_ptr<streamfx::util::profiler> _profiler_copy;
 		std::shared_ptr<streamfx::util::profiler> _profiler_encode;
@@ -118,6 +155,38 @@ namespace streamfx::encoder::aom::av1 {
 		virtual void get_video_info(struct video_scale_info* info);
 
 		virtual bool encode_video(encoder_frame* frame, encoder_packet* packet, bool* received_packet);
+
+		/** Average and maximum distance in frames between the submitted frame and the packet handed to OBS. */
+		std::pair<double, uint64_t> get_packet_latency();
+
+		private:
+		void apply_image_info(aom_image_t& image);
+
+		bool wrap_frame(encoder_frame* frame);
+
+		/** Adjust the CPU Usage so that encoding stays within the target share of the frame interval.
+		 *
+		 * Speeds up as soon as a window of frames was too slow, but only slows down again after several calm windows.
+		 * Each slow down that is immediately undone doubles the number of calm windows required, to prevent
+		 * oscillating between two levels.
+		 */
+		void adapt_cpuusage(std::chrono::nanoseconds duration);
+
+		void queue_packets();
+
+		void flush_packets();
+
+#ifdef ENABLE_PROFILING
+		public: // Profiling
+		/** Time spent wrapping or copying the input frame. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_copy();
+
+		/** Time spent encoding the input frame. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_encode();
+
+		/** Time spent retrieving packets from the encoder. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_packet();
+#endif
 	};
 
 	class aom_av1_factory : public obs::encoder_factory<aom_av1_factory, aom_av1_instance> {
@@ -21,6 +21,7 @@
 
 #include "encoder-ffmpeg.hpp"
 #include "strings.hpp"
+#include <optional>
 #include <sstream>
 #include "codecs/hevc.hpp"
 #include "ffmpeg/tools.hpp"
@@ -28,6 +29,10 @@
 #include "obs/gs/gs-helper.hpp"
 #include "plugin.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "util/util-trace.hpp"
+#endif
+
 #ifdef ENABLE_ENCODER_FFMPEG_AMF
 #include "handlers/amf_h264_handler.hpp"
 #include "handlers/amf_hevc_handler.hpp"
@@ -71,6 +76,12 @@ extern "C" {
 #define ST_KEY_FFMPEG_THREADS "FFmpeg.Threads"
 #define ST_I18N_FFMPEG_GPU ST_I18N_FFMPEG ".GPU"
 #define ST_KEY_FFMPEG_GPU "FFmpeg.GPU"
+#define ST_I18N_FFMPEG_ASYNC ST_I18N_FFMPEG ".Async"
+#define ST_KEY_FFMPEG_ASYNC "FFmpeg.Async"
+#define ST_I18N_FFMPEG_FRAMEPARALLEL ST_I18N_FFMPEG ".FrameParallel"
+#define ST_KEY_FFMPEG_FRAMEPARALLEL "FFmpeg.FrameParallel"
+#define ST_I18N_FFMPEG_SHAREDSCALING ST_I18N_FFMPEG ".SharedScaling"
+#define ST_KEY_FFMPEG_SHAREDSCALING "FFmpeg.SharedScaling"
 
 #define ST_I18N_KEYFRAMES ST_I18N_FFMPEG ".KeyFrames"
 #define ST_I18N_KEYFRAMES_INTERVALTYPE ST_I18N_KEYFRAMES ".IntervalType"
@@ -80,9 +91,41 @@ extern "C" {
 #define ST_KEY_KEYFRAMES_INTERVAL_SECONDS "KeyFrames.Interval.Seconds"
 #define ST_KEY_KEYFRAMES_INTERVAL_FRAMES "KeyFrames.Interval.Frames"
 
+// Frames which may wait for the encoder thread, before OBS has to wait as well.
+#define ST_ASYNC_QUEUE 8
+
+// Submission times kept for latency measurements, in case an encoder drops frames.
+#define ST_ASYNC_SUBMITTED_LIMIT 1024
+
+// Alignment of planes and line sizes required to encode straight from the memory of OBS, same as our own frames.
+#define ST_WRAP_ALIGNMENT 32
+
 using namespace streamfx::encoder::ffmpeg;
 using namespace streamfx::encoder::codec;
 
+// Only hardware encoders share the device of OBS, software encoders must not stall rendering while they work.
+class graphics_scope {
+	std::optional<streamfx::obs::gs::context> _gctx;
+	std::chrono::nanoseconds&                 _held;
+	std::chrono::steady_clock::time_point     _start;
+
+	public:
+	graphics_scope(bool enter, std::chrono::nanoseconds& held) : _gctx(), _held(held), _start()
+	{
+		if (enter) {
+			_gctx.emplace();
+			_start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~graphics_scope()
+	{
+		if (_gctx) {
+			_held += std::chrono::steady_clock::now() - _start;
+		}
+	}
+};
+
 enum class keyframe_type { SECONDS, FRAMES };
 
 ffmpeg_instance::ffmpeg_instance(obs_data_t* settings, obs_encoder_t* self, bool is_hw)
@@ -92,14 +135,31 @@ ffmpeg_instance::ffmpeg_instance(obs_data_t* settings, obs_encoder_t* self, bool
 
 	  _codec(_factory->get_avcodec()), _context(nullptr), _handler(ffmpeg_manager::get()->get_handler(_codec->name)),
 
-	  _scaler(), _packet(),
+	  _scaler(), _packet(), _pyramid(), _pyramid_consumer(0),
 
 	  _hwapi(), _hwinst(),
 
 	  _lag_in_frames(0), _sent_frames(0), _have_first_frame(false), _extra_data(), _sei_data(),
 
-	  _free_frames(), _used_frames(), _free_frames_last_used()
+	  _free_frames(), _used_frames(), _free_frames_last_used(), _free_frames_lock(),
+
+	  _async(false), _async_thread(), _async_lock(), _async_context_lock(), _async_work(), _async_space(),
+	  _async_input(), _async_output(), _async_packet(), _async_shutdown(false), _async_error(0), _async_input_peak(0),
+	  _async_output_peak(0),
+
+	  _parallel(), _parallel_done(), _parallel_submitted(0), _parallel_emitted(0), _parallel_pending(0),
+
+	  _wrap_frames(false), _graphics_held(0)
 {
+#ifdef ENABLE_PROFILING
+	// Profilers
+	_profiler_copy     = streamfx::util::profiler::create();
+	_profiler_convert  = streamfx::util::profiler::create();
+	_profiler_encode   = streamfx::util::profiler::create();
+	_profiler_latency  = streamfx::util::profiler::create();
+	_profiler_graphics = streamfx::util::profiler::create();
+#endif
+
 	// Initialize GPU Stuff
 	if (is_hw) {
 		// Abort if user specified manual override.
@@ -138,22 +198,128 @@ ffmpeg_instance::ffmpeg_instance(obs_data_t* settings, obs_encoder_t* self, bool
 		initialize_hw(settings);
 	} else {
 		initialize_sw(settings);
+
+		// Hardware frames depend on the texture locks OBS hands us, so only software encoding can be asynchronous.
+		_async = obs_data_get_bool(settings, ST_KEY_FFMPEG_ASYNC);
 	}
 
 	// Update settings
 	update(settings);
 
+	// Intra-only codecs scale better by encoding whole frames in parallel than by their own threading, so every
+	// context is limited to a single thread.
+	std::size_t parallel = 0;
+	if (!_hwinst && obs_data_get_bool(settings, ST_KEY_FFMPEG_FRAMEPARALLEL) && _handler
+		&& _handler->has_frame_parallel_support(_factory)) {
+		int64_t threads = obs_data_get_int(settings, ST_KEY_FFMPEG_THREADS);
+		parallel = (threads > 0) ? static_cast<std::size_t>(threads) : std::thread::hardware_concurrency();
+		parallel = std::min(parallel, streamfx::threadpool()->size());
+		if (parallel > 1) {
+			_context->thread_type  = 0;
+			_context->thread_count = 1;
+			_context->delay        = 0;
+			_async                 = false;
+		}
+	}
+
 	// Initialize Encoder
-	auto gctx = streamfx::obs::gs::context();
-	int  res  = avcodec_open2(_context, _codec, NULL);
-	if (res < 0) {
-		throw std::runtime_error(::streamfx::ffmpeg::tools::get_error_description(res));
+	{
+		graphics_scope gctx(_hwinst != nullptr, _graphics_held);
+		if (int res = avcodec_open2(_context, _codec, NULL); res < 0) {
+			throw std::runtime_error(::streamfx::ffmpeg::tools::get_error_description(res));
+		}
+	}
+
+	if (parallel > 1) {
+		initialize_parallel(parallel);
+	}
+
+	// Encoders which are done with a frame once avcodec_send_frame returns can read straight from the memory of OBS.
+	// Delayed and frame threaded encoding keep references, and so does handing frames to our own encoder thread.
+	if (!_hwinst && !_async && _parallel.empty()) {
+		_wrap_frames = ((_codec->capabilities & AV_CODEC_CAP_DELAY) == 0)
+					   && ((_context->active_thread_type & FF_THREAD_FRAME) == 0);
+		if (_wrap_frames) {
+			DLOG_INFO("[%s] Frames which need no conversion are encoded without a copy.", _codec->name);
+		}
+	}
+
+	// Start the encoder thread last, so that it never sees a partially initialized context.
+	if (_async) {
+		_async_thread = std::thread(&ffmpeg_instance::async_main, this);
 	}
 }
 
 ffmpeg_instance::~ffmpeg_instance()
 {
-	auto gctx = streamfx::obs::gs::context();
+	// Frames which are still being encoded reference this instance.
+	if (_parallel.size() > 0) {
+		std::unique_lock<std::mutex> lock(_async_lock);
+		_async_space.wait(lock, [this]() { return _parallel_pending == 0; });
+
+		DLOG_INFO("[%s] Frame-parallel encoding held up to %zu finished packets.", _codec->name,
+				  _async_output_peak);
+
+		// OBS never asks encoders to drain, so whatever was still in flight when it stopped can't be delivered.
+		if (_parallel_submitted > _parallel_emitted) {
+			DLOG_WARNING("[%s] The last %" PRIu64 " frames were encoded, but OBS stopped before it took them.",
+						 _codec->name, _parallel_submitted - _parallel_emitted);
+		}
+	}
+
+	// Stop the encoder thread before anything else touches the context. It sends every frame OBS handed over first,
+	// but packets for those and whatever the encoder itself still holds can't be delivered anymore, as OBS never
+	// asks encoders to drain.
+	if (_async_thread.joinable()) {
+		{
+			std::unique_lock<std::mutex> lock(_async_lock);
+			_async_shutdown = true;
+		}
+		_async_work.notify_all();
+		_async_thread.join();
+
+		if (!_async_output.empty()) {
+			DLOG_WARNING("[%s] The last %zu packets were encoded, but OBS stopped before it took them.", _codec->name,
+						 _async_output.size());
+		}
+
+		DLOG_INFO("[%s] Asynchronous encoding queued up to %zu frames and %zu packets.", _codec->name,
+				  _async_input_peak, _async_output_peak);
+#ifdef ENABLE_PROFILING
+		DLOG_INFO("[%s] Latency: %.1f µs average, %" PRId64 " µs 99.0ile, %" PRIu64 " samples.", _codec->name,
+				  _profiler_latency->average_duration() / 1000.,
+				  std::chrono::duration_cast<std::chrono::microseconds>(_profiler_latency->percentile(0.990)).count(),
+				  _profiler_latency->count());
+#endif
+	}
+
+#ifdef ENABLE_PROFILING
+	if (_profiler_convert->count() > 0) {
+		DLOG_INFO("[%s] Conversion from '%s' to '%s' took %.1f µs per frame on average, %" PRId64
+				  " µs 99.0ile, in %zu slices.",
+				  _codec->name, ::streamfx::ffmpeg::tools::get_pixel_format_name(_scaler.get_source_format()),
+				  ::streamfx::ffmpeg::tools::get_pixel_format_name(_scaler.get_target_format()),
+				  _profiler_convert->average_duration() / 1000.,
+				  std::chrono::duration_cast<std::chrono::microseconds>(_profiler_convert->percentile(0.990)).count(),
+				  _scaler.get_slices());
+	}
+	if (_pyramid) {
+		if (auto profiler = _pyramid->get_profiler(_pyramid_consumer); profiler && (profiler->count() > 0)) {
+			DLOG_INFO("[%s] Shared scaling to %" PRIu32 "x%" PRIu32 " took %.1f µs of CPU time per frame on average, "
+					  "%" PRId64 " µs 99.0ile.",
+					  _codec->name, _scaler.get_target_width(), _scaler.get_target_height(),
+					  profiler->average_duration() / 1000.,
+					  std::chrono::duration_cast<std::chrono::microseconds>(profiler->percentile(0.990)).count());
+		}
+	}
+	if (_profiler_graphics->count() > 0) {
+		DLOG_INFO("[%s] Graphics context held for %.1f µs per frame on average, %" PRId64 " µs 99.0ile.",
+				  _codec->name, _profiler_graphics->average_duration() / 1000.,
+				  std::chrono::duration_cast<std::chrono::microseconds>(_profiler_graphics->percentile(0.990)).count());
+	}
+#endif
+
+	graphics_scope gctx(_hwinst != nullptr, _graphics_held);
 	if (_context) {
 		// Flush encoders that require it.
 		if ((_codec->capabilities & AV_CODEC_CAP_DELAY) != 0) {
@@ -169,9 +335,19 @@ ffmpeg_instance::~ffmpeg_instance()
 		avcodec_free_context(&_context);
 	}
 
+	// The first frame-parallel context is the main one, which is already gone.
+	for (std::size_t idx = 1; idx < _parallel.size(); idx++) {
+		avcodec_free_context(&_parallel[idx]->context);
+	}
+	_parallel.clear();
+
 	av_packet_unref(&_packet);
 
 	_scaler.finalize();
+	if (_pyramid) {
+		_pyramid->remove(_pyramid_consumer);
+		_pyramid.reset();
+	}
 }
 
 void ffmpeg_instance::get_properties(obs_properties_t* props)
@@ -185,6 +361,9 @@ void ffmpeg_instance::get_properties(obs_properties_t* props)
 
 	obs_property_set_enabled(obs_properties_get(props, ST_KEY_FFMPEG_THREADS), false);
 	obs_property_set_enabled(obs_properties_get(props, ST_KEY_FFMPEG_GPU), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_KEY_FFMPEG_ASYNC), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_KEY_FFMPEG_FRAMEPARALLEL), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_KEY_FFMPEG_SHAREDSCALING), false);
 }
 
 void ffmpeg_instance::migrate(obs_data_t* settings, uint64_t version)
@@ -195,6 +374,9 @@ void ffmpeg_instance::migrate(obs_data_t* settings, uint64_t version)
 
 bool ffmpeg_instance::update(obs_data_t* settings)
 {
+	// The encoder thread or pool may be in the middle of a frame on the same context.
+	std::unique_lock<std::mutex> context_lock(_async_context_lock);
+
 	bool support_reconfig           = false;
 	bool support_reconfig_threads   = false;
 	bool support_reconfig_gpu       = false;
@@ -221,7 +403,7 @@ bool ffmpeg_instance::update(obs_data_t* settings)
 				_context->thread_type |= FF_THREAD_SLICE;
 			}
 			if (_context->thread_type != 0) {
-				int64_t threads = obs_data_get_int(settings, ST_I18N_FFMPEG_THREADS);
+				int64_t threads = obs_data_get_int(settings, ST_KEY_FFMPEG_THREADS);
 				if (threads > 0) {
 					_context->thread_count = static_cast<int>(threads);
 				} else {
@@ -312,6 +494,11 @@ bool ffmpeg_instance::update(obs_data_t* settings)
 					  ::streamfx::ffmpeg::tools::get_pixel_format_name(_scaler.get_target_format()),
 					  ::streamfx::ffmpeg::tools::get_color_space_name(_scaler.get_target_colorspace()),
 					  _scaler.is_target_full_range() ? "Full" : "Partial");
+			if (_pyramid) {
+				DLOG_INFO("[%s]     Conversion: Shared, %zu renditions", _codec->name, _pyramid->size());
+			} else {
+				DLOG_INFO("[%s]     Conversion: %zu slices", _codec->name, _scaler.get_slices());
+			}
 			if (!_hwinst)
 				DLOG_INFO("[%s]     On GPU Index: %lli", _codec->name, obs_data_get_int(settings, ST_KEY_FFMPEG_GPU));
 		}
@@ -345,23 +532,24 @@ static inline void copy_data(encoder_frame* frame, AVFrame* vframe)
 			continue;
 
 		std::size_t plane_height = static_cast<size_t>(vframe->height) >> (idx ? v_chroma_shift : 0);
+		std::size_t ls_in        = static_cast<size_t>(frame->linesize[idx]);
+		std::size_t ls_out       = static_cast<size_t>(vframe->linesize[idx]);
+		std::size_t bytes        = ls_in < ls_out ? ls_in : ls_out;
 
-		if (static_cast<uint32_t>(vframe->linesize[idx]) == frame->linesize[idx]) {
-			std::memcpy(vframe->data[idx], frame->data[idx], frame->linesize[idx] * plane_height);
-		} else {
-			std::size_t ls_in  = static_cast<size_t>(frame->linesize[idx]);
-			std::size_t ls_out = static_cast<size_t>(vframe->linesize[idx]);
-			std::size_t bytes  = ls_in < ls_out ? ls_in : ls_out;
-
-			uint8_t* to   = vframe->data[idx];
-			uint8_t* from = frame->data[idx];
+		uint8_t* to   = vframe->data[idx];
+		uint8_t* from = frame->data[idx];
 
-			for (std::size_t y = 0; y < plane_height; y++) {
-				std::memcpy(to, from, bytes);
-				to += ls_out;
-				from += ls_in;
+		// Split the plane into bands of rows, and copy those in parallel.
+		auto copy_rows = [to, from, ls_in, ls_out, bytes](std::size_t begin, std::size_t end) {
+			if (ls_in == ls_out) {
+				std::memcpy(to + ls_out * begin, from + ls_in * begin, ls_in * (end - begin));
+			} else {
+				for (std::size_t y = begin; y < end; y++) {
+					std::memcpy(to + ls_out * y, from + ls_in * y, bytes);
+				}
 			}
-		}
+		};
+		streamfx::threadpool()->parallel_rows(plane_height, bytes, copy_rows);
 	}
 }
 
@@ -372,10 +560,37 @@ bool ffmpeg_instance::encode_audio(struct encoder_frame* frame, struct encoder_p
 
 bool ffmpeg_instance::encode_video(struct encoder_frame* frame, struct encoder_packet* packet, bool* received_packet)
 {
-	std::shared_ptr<AVFrame> vframe = pop_free_frame(); // Retrieve an empty frame.
+	bool direct = (_scaler.is_source_full_range() == _scaler.is_target_full_range())
+				  && (_scaler.get_source_colorspace() == _scaler.get_target_colorspace())
+				  && (_scaler.get_source_format() == _scaler.get_target_format());
+
+	bool wrapped = direct && _wrap_frames && can_wrap_frame(frame);
+
+	std::shared_ptr<AVFrame> vframe;
+	_graphics_held = std::chrono::nanoseconds(0);
 
 	// Convert frame.
 	{
+#ifdef ENABLE_PROFILING
+		auto profile = _profiler_copy->track();
+#endif
+		if (_pyramid) {
+#ifdef ENABLE_PROFILING
+			auto profile_convert = _profiler_convert->track();
+#endif
+			// Encoders which started at different times have different timestamps, but share the frame count.
+			vframe = _pyramid->convert(_pyramid_consumer, video_output_get_total_frames(obs_encoder_video(_self)),
+									   frame->data, reinterpret_cast<const int*>(frame->linesize));
+			if (!vframe) {
+				DLOG_ERROR("Failed to convert frame.");
+				return false;
+			}
+		} else if (wrapped) {
+			vframe = wrap_frame(frame);
+		} else {
+			vframe = pop_free_frame(); // Retrieve an empty frame.
+		}
+
 		vframe->height          = _context->height;
 		vframe->format          = _context->pix_fmt;
 		vframe->color_range     = _context->color_range;
@@ -384,11 +599,16 @@ bool ffmpeg_instance::encode_video(struct encoder_frame* frame, struct encoder_p
 		vframe->color_trc       = _context->color_trc;
 		vframe->pts             = frame->pts;
 
-		if ((_scaler.is_source_full_range() == _scaler.is_target_full_range())
-			&& (_scaler.get_source_colorspace() == _scaler.get_target_colorspace())
-			&& (_scaler.get_source_format() == _scaler.get_target_format())) {
-			copy_data(frame, vframe.get());
+		if (_pyramid) {
+			// Already converted and scaled.
+		} else if (direct) {
+			if (!wrapped) {
+				copy_data(frame, vframe.get());
+			}
 		} else {
+#ifdef ENABLE_PROFILING
+			auto profile_convert = _profiler_convert->track();
+#endif
 			int res = _scaler.convert(reinterpret_cast<uint8_t**>(frame->data), reinterpret_cast<int*>(frame->linesize),
 									  0, _context->height, vframe->data, vframe->linesize);
 			if (res <= 0) {
@@ -399,9 +619,17 @@ bool ffmpeg_instance::encode_video(struct encoder_frame* frame, struct encoder_p
 		}
 	}
 
-	if (!encode_avframe(vframe, packet, received_packet))
-		return false;
+	{
+#ifdef ENABLE_PROFILING
+		auto profile = _profiler_encode->track();
+#endif
+		if (!encode_avframe(vframe, packet, received_packet))
+			return false;
+	}
 
+#ifdef ENABLE_PROFILING
+	_profiler_graphics->track(_graphics_held);
+#endif
 	return true;
 }
 
@@ -416,7 +644,11 @@ bool ffmpeg_instance::encode_video(uint32_t handle, int64_t pts, uint64_t lock_k
 	}
 
 	std::shared_ptr<AVFrame> vframe = pop_free_frame();
-	_hwinst->copy_from_obs(_context->hw_frames_ctx, handle, lock_key, next_key, vframe);
+	_graphics_held                  = std::chrono::nanoseconds(0);
+	{
+		graphics_scope gctx(true, _graphics_held);
+		_hwinst->copy_from_obs(_context->hw_frames_ctx, handle, lock_key, next_key, vframe);
+	}
 
 	vframe->color_range     = _context->color_range;
 	vframe->colorspace      = _context->colorspace;
@@ -429,6 +661,9 @@ bool ffmpeg_instance::encode_video(uint32_t handle, int64_t pts, uint64_t lock_k
 
 	*next_key = lock_key;
 
+#ifdef ENABLE_PROFILING
+	_profiler_graphics->track(_graphics_held);
+#endif
 	return true;
 #else
 	return false;
@@ -472,7 +707,18 @@ void ffmpeg_instance::initialize_sw(obs_data_t* settings)
 		_scaler.set_target_format(pix_fmt_target);
 
 		// Create Scaler
-		if (!_scaler.initialize(SWS_POINT)) {
+		if (obs_data_get_bool(settings, ST_KEY_FFMPEG_SHAREDSCALING)) {
+			// libOBS would scale the video for every encoder on its own, so ask for the unscaled video instead and
+			// share conversion and scaling with every other encoder on it.
+			_scaler.set_source_size(voi->width, voi->height);
+			_pyramid = ::streamfx::ffmpeg::scaling_pyramid::get(obs_encoder_video(_self), voi->width, voi->height,
+																pix_fmt_source, _scaler.is_source_full_range(),
+																_scaler.get_source_colorspace());
+			_pyramid_consumer = _pyramid->add(static_cast<uint32_t>(_context->width),
+											  static_cast<uint32_t>(_context->height), pix_fmt_target);
+			DLOG_INFO("[%s] Sharing conversion and scaling of the input with %zu other renditions.", _codec->name,
+					  _pyramid->size() - 1);
+		} else if (!_scaler.initialize(SWS_POINT)) {
 			std::stringstream sstr;
 			sstr << "Initializing scaler failed for conversion from '"
 				 << ::streamfx::ffmpeg::tools::get_pixel_format_name(_scaler.get_source_format()) << "' to '"
@@ -482,6 +728,19 @@ void ffmpeg_instance::initialize_sw(obs_data_t* settings)
 				 << (_scaler.is_source_full_range() ? "full" : "partial") << " range.";
 			throw std::runtime_error(sstr.str());
 		}
+
+		// libOBS converts to its own color format on the GPU, but anything after that is up to us and the CPU. Point
+		// out when a different color format in OBS would move most of that work to the GPU.
+		if (pix_fmt_source != pix_fmt_target) {
+			if (auto closest = ::streamfx::ffmpeg::tools::get_closest_gpu_videoformat(pix_fmt_target);
+				(closest != VIDEO_FORMAT_NONE) && (closest != voi->format)) {
+				DLOG_WARNING("[%s] Frames are converted from '%s' to '%s' on the CPU. Setting the color format in OBS "
+							 "to '%s' would move most of this work to the GPU.",
+							 _codec->name, ::streamfx::ffmpeg::tools::get_pixel_format_name(pix_fmt_source),
+							 ::streamfx::ffmpeg::tools::get_pixel_format_name(pix_fmt_target),
+							 get_video_format_name(closest));
+			}
+		}
 	}
 }
 
@@ -521,9 +780,80 @@ void ffmpeg_instance::initialize_hw(obs_data_t*)
 #endif
 }
 
+static void wrapped_frame_free(void*, uint8_t*)
+{
+	// The memory belongs to OBS.
+}
+
+void ffmpeg_instance::initialize_parallel(std::size_t count)
+{
+	// The already opened context encodes as well, all others are copies of it.
+	_parallel.push_back(std::make_unique<parallel_context>());
+	_parallel.back()->context = _context;
+	_parallel.back()->running = false;
+
+	for (std::size_t idx = 1; idx < count; idx++) {
+		AVCodecContext* context = avcodec_alloc_context3(_codec);
+		int             res     = context ? 0 : AVERROR(ENOMEM);
+		if (res >= 0) {
+			res = av_opt_copy(context, _context);
+		}
+		if ((res >= 0) && context->priv_data && _context->priv_data) {
+			res = av_opt_copy(context->priv_data, _context->priv_data);
+		}
+		if (res >= 0) {
+			// Not everything is exposed as an option.
+			context->width                  = _context->width;
+			context->height                 = _context->height;
+			context->pix_fmt                = _context->pix_fmt;
+			context->time_base              = _context->time_base;
+			context->framerate              = _context->framerate;
+			context->sample_aspect_ratio    = _context->sample_aspect_ratio;
+			context->color_range            = _context->color_range;
+			context->color_primaries        = _context->color_primaries;
+			context->color_trc              = _context->color_trc;
+			context->colorspace             = _context->colorspace;
+			context->chroma_sample_location = _context->chroma_sample_location;
+			context->field_order            = _context->field_order;
+			context->profile                = _context->profile;
+			context->thread_type            = 0;
+			context->thread_count           = 1;
+			context->delay                  = 0;
+			res                             = avcodec_open2(context, _codec, NULL);
+		}
+		if (res < 0) {
+			DLOG_WARNING("[%s] Failed to create context %zu for frame-parallel encoding: %s (%" PRId32 ").",
+						 _codec->name, idx, ::streamfx::ffmpeg::tools::get_error_description(res), res);
+			avcodec_free_context(&context);
+			break;
+		}
+
+		_parallel.push_back(std::make_unique<parallel_context>());
+		_parallel.back()->context = context;
+		_parallel.back()->running = false;
+	}
+
+	if (_parallel.size() < 2) {
+		_parallel.clear();
+		return;
+	}
+	DLOG_INFO("[%s] Encoding up to %zu frames in parallel.", _codec->name, _parallel.size());
+}
+
 void ffmpeg_instance::push_free_frame(std::shared_ptr<AVFrame> frame)
 {
-	auto now = std::chrono::high_resolution_clock::now();
+	// Shared frames are recycled by the pyramid once every encoder lets go of them.
+	if (_pyramid) {
+		return;
+	}
+
+	// Wrapped frames point at memory which is only valid during a single encode call.
+	if (frame->buf[0] && (av_buffer_get_opaque(frame->buf[0]) == this)) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_free_frames_lock);
+	auto                         now = std::chrono::high_resolution_clock::now();
 	if (_free_frames.size() > 0) {
 		if ((now - _free_frames_last_used) < std::chrono::seconds(1)) {
 			_free_frames.push(frame);
@@ -537,11 +867,21 @@ void ffmpeg_instance::push_free_frame(std::shared_ptr<AVFrame> frame)
 std::shared_ptr<AVFrame> ffmpeg_instance::pop_free_frame()
 {
 	std::shared_ptr<AVFrame> frame;
-	if (_free_frames.size() > 0) {
-		// Re-use existing frames first.
-		frame = _free_frames.top();
-		_free_frames.pop();
-	} else {
+	{
+		std::unique_lock<std::mutex> lock(_free_frames_lock);
+		if (_free_frames.size() > 0) {
+			// Re-use existing frames first.
+			frame = _free_frames.top();
+			_free_frames.pop();
+		}
+	}
+
+	// Encoders may still hold a reference to the buffers of a recycled frame, so never write into those.
+	if (frame && !_hwinst && !av_frame_is_writable(frame.get())) {
+		frame = nullptr;
+	}
+
+	if (!frame) {
 		if (_hwinst) {
 			frame = _hwinst->allocate_frame(_context->hw_frames_ctx);
 		} else {
@@ -576,6 +916,58 @@ std::shared_ptr<AVFrame> ffmpeg_instance::pop_used_frame()
 	return frame;
 }
 
+bool ffmpeg_instance::can_wrap_frame(struct encoder_frame* frame)
+{
+	// Encoders may use SIMD loads which assume FFmpeg's own frame alignment, which OBS does not guarantee.
+	for (std::size_t idx = 0; (idx < MAX_AV_PLANES) && (idx < AV_NUM_DATA_POINTERS); idx++) {
+		if (!frame->data[idx])
+			break;
+
+		if (((frame->linesize[idx] % ST_WRAP_ALIGNMENT) != 0)
+			|| ((reinterpret_cast<uintptr_t>(frame->data[idx]) % ST_WRAP_ALIGNMENT) != 0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<AVFrame> ffmpeg_instance::wrap_frame(struct encoder_frame* frame)
+{
+	auto vframe = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* ptr) {
+		av_frame_unref(ptr);
+		av_frame_free(&ptr);
+	});
+	if (!vframe) {
+		throw std::bad_alloc();
+	}
+
+	vframe->width  = _context->width;
+	vframe->height = _context->height;
+	vframe->format = _context->pix_fmt;
+
+	int h_chroma_shift, v_chroma_shift;
+	av_pix_fmt_get_chroma_sub_sample(_context->pix_fmt, &h_chroma_shift, &v_chroma_shift);
+
+	// Only used for frames which passed can_wrap_frame(), so planes and line sizes are aligned.
+	for (std::size_t idx = 0; (idx < MAX_AV_PLANES) && (idx < AV_NUM_DATA_POINTERS); idx++) {
+		if (!frame->data[idx])
+			break;
+
+		std::size_t plane_height = static_cast<size_t>(_context->height) >> (idx ? v_chroma_shift : 0);
+		std::size_t size         = static_cast<size_t>(frame->linesize[idx]) * plane_height;
+
+		// Marked with this instance, so that it never ends up in the frame pool.
+		vframe->buf[idx] = av_buffer_create(frame->data[idx], static_cast<int>(size), wrapped_frame_free, this, 0);
+		if (!vframe->buf[idx]) {
+			throw std::bad_alloc();
+		}
+		vframe->data[idx]     = frame->data[idx];
+		vframe->linesize[idx] = static_cast<int>(frame->linesize[idx]);
+	}
+
+	return vframe;
+}
+
 bool ffmpeg_instance::get_extra_data(uint8_t** data, size_t* size)
 {
 	if (_extra_data.size() == 0)
@@ -601,6 +993,12 @@ void ffmpeg_instance::get_video_info(struct video_scale_info* info)
 	if (!is_hardware_encode()) {
 		// Override input with supported format if software encode.
 		info->format = ::streamfx::ffmpeg::tools::avpixelformat_to_obs_videoformat(_scaler.get_source_format());
+
+		// libOBS only scales if the size differs from the video.
+		if (_pyramid) {
+			info->width  = _scaler.get_source_width();
+			info->height = _scaler.get_source_height();
+		}
 	}
 }
 
@@ -611,13 +1009,24 @@ int ffmpeg_instance::receive_packet(bool* received_packet, struct encoder_packet
 	av_packet_unref(&_packet);
 
 	{
-		auto gctx = streamfx::obs::gs::context();
-		res       = avcodec_receive_packet(_context, &_packet);
+		graphics_scope gctx(_hwinst != nullptr, _graphics_held);
+		res = avcodec_receive_packet(_context, &_packet);
 	}
 	if (res != 0) {
 		return res;
 	}
 
+	prepare_packet(_packet, _context);
+	process_packet(_packet, packet, received_packet);
+
+	// Push free frame back into pool.
+	push_free_frame(pop_used_frame());
+
+	return res;
+}
+
+void ffmpeg_instance::prepare_packet(AVPacket& avpacket, AVCodecContext* context)
+{
 	if (!_have_first_frame) {
 		if (_codec->id == AV_CODEC_ID_H264) {
 			uint8_t*    tmp_packet;
@@ -625,7 +1034,7 @@ int ffmpeg_instance::receive_packet(bool* received_packet, struct encoder_packet
 			uint8_t*    tmp_sei;
 			std::size_t sz_packet, sz_header, sz_sei;
 
-			obs_extract_avc_headers(_packet.data, static_cast<size_t>(_packet.size), &tmp_packet, &sz_packet,
+			obs_extract_avc_headers(avpacket.data, static_cast<size_t>(avpacket.size), &tmp_packet, &sz_packet,
 									&tmp_header, &sz_header, &tmp_sei, &sz_sei);
 
 			if (sz_header) {
@@ -646,39 +1055,42 @@ int ffmpeg_instance::receive_packet(bool* received_packet, struct encoder_packet
 			bfree(tmp_header);
 			bfree(tmp_sei);
 		} else if (_codec->id == AV_CODEC_ID_HEVC) {
-			hevc::extract_header_sei(_packet.data, static_cast<size_t>(_packet.size), _extra_data, _sei_data);
-		} else if (_context->extradata != nullptr) {
-			_extra_data.resize(static_cast<size_t>(_context->extradata_size));
-			std::memcpy(_extra_data.data(), _context->extradata, static_cast<size_t>(_context->extradata_size));
+			hevc::extract_header_sei(avpacket.data, static_cast<size_t>(avpacket.size), _extra_data, _sei_data);
+		} else if (context->extradata != nullptr) {
+			_extra_data.resize(static_cast<size_t>(context->extradata_size));
+			std::memcpy(_extra_data.data(), context->extradata, static_cast<size_t>(context->extradata_size));
 		}
 		_have_first_frame = true;
 	}
 
 	// Allow Handler Post-Processing
 	if (_handler)
-		_handler->process_avpacket(_packet, _codec, _context);
+		_handler->process_avpacket(avpacket, _codec, context);
+}
 
+void ffmpeg_instance::process_packet(AVPacket& avpacket, struct encoder_packet* packet, bool* received_packet)
+{
 	// Build packet for use in OBS.
 	packet->type     = OBS_ENCODER_VIDEO;
-	packet->pts      = _packet.pts;
-	packet->dts      = _packet.dts;
-	packet->data     = _packet.data;
-	packet->size     = static_cast<size_t>(_packet.size);
-	packet->keyframe = !!(_packet.flags & AV_PKT_FLAG_KEY);
+	packet->pts      = avpacket.pts;
+	packet->dts      = avpacket.dts;
+	packet->data     = avpacket.data;
+	packet->size     = static_cast<size_t>(avpacket.size);
+	packet->keyframe = !!(avpacket.flags & AV_PKT_FLAG_KEY);
 	*received_packet = true;
 
 	// Figure out priority and drop_priority.
 	// In theory, this is done by OBS, but its not doing a great job.
 	packet->priority      = packet->keyframe ? 3 : 2;
 	packet->drop_priority = 3;
-	for (size_t idx = 0, edx = _packet.side_data_elems; idx < edx; idx++) {
-		auto& side_data = _packet.side_data[idx];
+	for (size_t idx = 0, edx = avpacket.side_data_elems; idx < edx; idx++) {
+		auto& side_data = avpacket.side_data[idx];
 		if (side_data.type == AV_PKT_DATA_QUALITY_STATS) {
 			// Decisions based on picture type, if present.
 			switch (side_data.data[sizeof(uint32_t)]) {
 			case AV_PICTURE_TYPE_I:  // I-Frame
 			case AV_PICTURE_TYPE_SI: // Switching I-Frame
-				if (_packet.flags & AV_PKT_FLAG_KEY) {
+				if (avpacket.flags & AV_PKT_FLAG_KEY) {
 					// Recovery only via IDR-Frame.
 					packet->priority      = 3; // OBS_NAL_PRIORITY_HIGHEST
 					packet->drop_priority = 2; // OBS_NAL_PRIORITY_HIGH
@@ -712,19 +1124,14 @@ int ffmpeg_instance::receive_packet(bool* received_packet, struct encoder_packet
 			}
 		}
 	}
-
-	// Push free frame back into pool.
-	push_free_frame(pop_used_frame());
-
-	return res;
 }
 
 int ffmpeg_instance::send_frame(std::shared_ptr<AVFrame> const frame)
 {
 	int res = 0;
 	{
-		auto gctx = streamfx::obs::gs::context();
-		res       = avcodec_send_frame(_context, frame.get());
+		graphics_scope gctx(_hwinst != nullptr, _graphics_held);
+		res = avcodec_send_frame(_context, frame.get());
 	}
 	if (res == 0) {
 		push_used_frame(frame);
@@ -735,6 +1142,12 @@ int ffmpeg_instance::send_frame(std::shared_ptr<AVFrame> const frame)
 
 bool ffmpeg_instance::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_packet* packet, bool* received_packet)
 {
+	if (_parallel.size() > 0) {
+		return encode_avframe_parallel(frame, packet, received_packet);
+	} else if (_async) {
+		return encode_avframe_async(frame, packet, received_packet);
+	}
+
 	bool sent_frame  = false;
 	bool recv_packet = false;
 	bool should_lag  = (_sent_frames >= _lag_in_frames);
@@ -809,6 +1222,268 @@ bool ffmpeg_instance::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_pac
 	return true;
 }
 
+bool ffmpeg_instance::encode_avframe_async(std::shared_ptr<AVFrame> frame, encoder_packet* packet,
+										   bool* received_packet)
+{
+	std::unique_lock<std::mutex> lock(_async_lock);
+
+	// Only wait if the encoder thread is a whole queue behind, which is where the synchronous path would stall too.
+	_async_space.wait(lock, [this]() { return (_async_input.size() < ST_ASYNC_QUEUE) || (_async_error != 0); });
+	if (_async_error != 0) {
+		DLOG_ERROR("Encoder thread failed: %s (%" PRId32 ").",
+				   ::streamfx::ffmpeg::tools::get_error_description(_async_error), _async_error);
+		return false;
+	}
+
+	_async_input.push_back(frame);
+	_async_input_peak = std::max(_async_input_peak, _async_input.size());
+#ifdef ENABLE_PROFILING
+	if (_async_submitted.size() >= ST_ASYNC_SUBMITTED_LIMIT) {
+		_async_submitted.erase(_async_submitted.begin());
+	}
+	_async_submitted.emplace(frame->pts, std::chrono::steady_clock::now());
+#endif
+	_async_work.notify_one();
+
+	// OBS takes one packet per call, and copies it before the next one.
+	if (_async_output.empty()) {
+		return true;
+	}
+	_async_packet = _async_output.front();
+	_async_output.pop_front();
+#ifdef ENABLE_PROFILING
+	if (auto kv = _async_submitted.find(_async_packet->pts); kv != _async_submitted.end()) {
+		_profiler_latency->track(std::chrono::steady_clock::now() - kv->second);
+		_async_submitted.erase(kv);
+	}
+#endif
+	lock.unlock();
+
+	process_packet(*_async_packet, packet, received_packet);
+	return true;
+}
+
+void ffmpeg_instance::async_main()
+{
+#ifdef ENABLE_PROFILING
+	streamfx::util::tracer::name_thread(std::string("ffmpeg::") + _codec->name);
+#endif
+
+	std::unique_lock<std::mutex> lock(_async_lock);
+	while (true) {
+		_async_work.wait(lock, [this]() { return _async_shutdown || !_async_input.empty(); });
+		if (_async_input.empty()) { // Only stop once everything OBS handed over was sent.
+			break;
+		}
+
+		auto frame = _async_input.front();
+		_async_input.pop_front();
+		_async_space.notify_one();
+		lock.unlock();
+
+		// Encoders may refuse new frames until their finished packets are taken out.
+		int res = 0;
+		{
+			std::unique_lock<std::mutex> context_lock(_async_context_lock);
+			while (true) {
+				res       = avcodec_send_frame(_context, frame.get());
+				int count = async_drain();
+				if (count < 0) {
+					res = count;
+					break;
+				} else if ((res != AVERROR(EAGAIN)) || (count == 0)) {
+					break;
+				}
+			}
+		}
+
+		// The encoder holds its own reference from here on.
+		push_free_frame(frame);
+
+		lock.lock();
+		if (res == AVERROR_EOF) {
+			DLOG_ERROR("Skipped frame due to end of stream.");
+		} else if (res == AVERROR(EAGAIN)) {
+			DLOG_ERROR("Both send and recieve returned EAGAIN, encoder is broken.");
+			_async_error = res;
+		} else if (res < 0) {
+			_async_error = res;
+		}
+
+		if (_async_error != 0) {
+			// Wake up OBS if it is waiting for room in the queue, so that it can see the error.
+			_async_space.notify_all();
+			break;
+		}
+	}
+}
+
+int ffmpeg_instance::async_drain()
+{
+	int count = 0;
+	while (true) {
+		std::shared_ptr<AVPacket> avpacket(av_packet_alloc(), [](AVPacket* ptr) { av_packet_free(&ptr); });
+		if (!avpacket) {
+			return AVERROR(ENOMEM);
+		}
+
+		int res = avcodec_receive_packet(_context, avpacket.get());
+		if ((res == AVERROR(EAGAIN)) || (res == AVERROR_EOF)) {
+			return count;
+		} else if (res < 0) {
+			return res;
+		}
+
+		// Anything that needs the context has to happen here, OBS takes the packet while the next frame is encoded.
+		prepare_packet(*avpacket, _context);
+
+		// Can't grow beyond the frames in flight, as every frame results in at most one packet.
+		std::unique_lock<std::mutex> lock(_async_lock);
+		_async_output.push_back(avpacket);
+		_async_output_peak = std::max(_async_output_peak, _async_output.size());
+		count++;
+	}
+}
+
+bool ffmpeg_instance::encode_avframe_parallel(std::shared_ptr<AVFrame> frame, encoder_packet* packet,
+											  bool* received_packet)
+{
+	std::unique_lock<std::mutex> lock(_async_lock);
+
+	// One frame per context at most. If all of them are busy, wait for the oldest frame instead of queueing more.
+	std::size_t limit = _parallel.size();
+	_async_space.wait(lock, [this, limit]() {
+		return ((_parallel_submitted - _parallel_emitted) < limit) || (_parallel_done.count(_parallel_emitted) > 0)
+			   || (_async_error != 0);
+	});
+	if (_async_error != 0) {
+		DLOG_ERROR("Frame-parallel encoding failed: %s (%" PRId32 ").",
+				   ::streamfx::ffmpeg::tools::get_error_description(_async_error), _async_error);
+		return false;
+	}
+
+	// Packets leave in the order the frames came in, one per call as OBS copies it before the next one.
+	auto emit = [this]() {
+		auto kv = _parallel_done.find(_parallel_emitted);
+		if (kv == _parallel_done.end()) {
+			return false;
+		}
+		_async_packet = kv->second;
+		_parallel_done.erase(kv);
+		_parallel_emitted++;
+#ifdef ENABLE_PROFILING
+		if (_async_packet) {
+			if (auto kv2 = _async_submitted.find(_async_packet->pts); kv2 != _async_submitted.end()) {
+				_profiler_latency->track(std::chrono::steady_clock::now() - kv2->second);
+				_async_submitted.erase(kv2);
+			}
+		}
+#endif
+		return true;
+	};
+
+	// Making room first frees up the context the new frame is about to use.
+	bool emitted = ((_parallel_submitted - _parallel_emitted) >= limit) && emit();
+
+	// Round-robin, so that consecutive frames end up in different contexts.
+	uint64_t          sequence = _parallel_submitted++;
+	parallel_context* slot     = _parallel[sequence % _parallel.size()].get();
+	slot->queue.emplace_back(sequence, frame);
+	_parallel_pending++;
+#ifdef ENABLE_PROFILING
+	if (_async_submitted.size() >= ST_ASYNC_SUBMITTED_LIMIT) {
+		_async_submitted.erase(_async_submitted.begin());
+	}
+	_async_submitted.emplace(frame->pts, std::chrono::steady_clock::now());
+#endif
+	bool start    = !slot->running;
+	slot->running = true;
+
+	// The oldest frame may have finished in the meantime, so hand it over now instead of a call later.
+	if (!emitted) {
+		emitted = emit();
+	}
+	lock.unlock();
+
+	if (start) {
+		// Runs on every exit path, so that frames of a task which the pool dropped are not waited for forever.
+		auto finished = std::make_shared<bool>(false);
+		auto guard    = std::shared_ptr<void>(nullptr, [this, slot, finished](void*) {
+			if (!*finished) {
+				parallel_abandon(slot);
+			}
+		});
+		streamfx::threadpool()->push(
+			[this, slot, finished, guard](streamfx::util::threadpool_data_t) {
+				parallel_drain(slot);
+				*finished = true;
+			},
+			nullptr);
+	}
+
+	if (emitted && _async_packet) {
+		process_packet(*_async_packet, packet, received_packet);
+	}
+	return true;
+}
+
+void ffmpeg_instance::parallel_drain(parallel_context* slot)
+{
+	std::unique_lock<std::mutex> lock(_async_lock);
+	while (!slot->queue.empty()) {
+		auto [sequence, frame] = slot->queue.front();
+		slot->queue.pop_front();
+		lock.unlock();
+
+		std::shared_ptr<AVPacket> avpacket(av_packet_alloc(), [](AVPacket* ptr) { av_packet_free(&ptr); });
+		int                       res = avpacket ? 0 : AVERROR(ENOMEM);
+		{
+			// The first context is the one update() reconfigures.
+			std::unique_lock<std::mutex> context_lock(_async_context_lock, std::defer_lock);
+			if (slot->context == _context) {
+				context_lock.lock();
+			}
+			if (res >= 0) {
+				res = avcodec_send_frame(slot->context, frame.get());
+			}
+			if (res >= 0) {
+				res = avcodec_receive_packet(slot->context, avpacket.get());
+			}
+		}
+		push_free_frame(frame);
+
+		lock.lock();
+		if (res < 0) {
+			_async_error = res;
+			avpacket     = nullptr;
+		} else {
+			// Under the lock, as every context shares the headers and the handler.
+			prepare_packet(*avpacket, slot->context);
+		}
+		_parallel_done.emplace(sequence, avpacket);
+		_async_output_peak = std::max(_async_output_peak, _parallel_done.size());
+		_parallel_pending--;
+		_async_space.notify_all();
+	}
+	slot->running = false;
+}
+
+void ffmpeg_instance::parallel_abandon(parallel_context* slot)
+{
+	std::unique_lock<std::mutex> lock(_async_lock);
+	if (!slot->queue.empty()) {
+		DLOG_WARNING("[%s] Dropped %zu frames, as the thread pool shut down before encoding them.", _codec->name,
+					 slot->queue.size());
+	}
+	for (auto& entry : slot->queue) {
+		_parallel_done.emplace(entry.first, nullptr);
+		_parallel_pending--;
+	}
+	slot->queue.clear();
+	slot->running = false;
+	_async_space.notify_all();
+}
+
 bool ffmpeg_instance::is_hardware_encode()
 {
 	return _hwinst != nullptr;
@@ -824,6 +1499,39 @@ const AVCodecContext* ffmpeg_instance::get_avcodeccontext()
 	return _context;
 }
 
+#ifdef ENABLE_PROFILING
+std::shared_ptr<streamfx::util::profiler> ffmpeg_instance::get_profiler_copy()
+{
+	return _profiler_copy;
+}
+
+std::shared_ptr<streamfx::util::profiler> ffmpeg_instance::get_profiler_encode()
+{
+	return _profiler_encode;
+}
+
+std::shared_ptr<streamfx::util::profiler> ffmpeg_instance::get_profiler_convert()
+{
+	return _profiler_convert;
+}
+
+std::shared_ptr<streamfx::util::profiler> ffmpeg_instance::get_profiler_latency()
+{
+	return _profiler_latency;
+}
+
+std::shared_ptr<streamfx::util::profiler> ffmpeg_instance::get_profiler_graphics()
+{
+	return _profiler_graphics;
+}
+#endif
+
+std::pair<std::size_t, std::size_t> ffmpeg_instance::get_queue_depth()
+{
+	std::unique_lock<std::mutex> lock(_async_lock);
+	return {_async_input.size() + _parallel_pending, _async_output.size() + _parallel_done.size()};
+}
+
 void ffmpeg_instance::parse_ffmpeg_commandline(std::string_view text)
 {
 	// Steps to properly parse a command line:
@@ -1041,6 +1749,9 @@ void ffmpeg_factory::get_defaults2(obs_data_t* settings)
 		obs_data_set_default_string(settings, ST_KEY_FFMPEG_CUSTOMSETTINGS, "");
 		obs_data_set_default_int(settings, ST_KEY_FFMPEG_THREADS, 0);
 		obs_data_set_default_int(settings, ST_KEY_FFMPEG_GPU, -1);
+		obs_data_set_default_bool(settings, ST_KEY_FFMPEG_ASYNC, false);
+		obs_data_set_default_bool(settings, ST_KEY_FFMPEG_FRAMEPARALLEL, false);
+		obs_data_set_default_bool(settings, ST_KEY_FFMPEG_SHAREDSCALING, false);
 	}
 }
 
@@ -1135,6 +1846,20 @@ obs_properties_t* ffmpeg_factory::get_properties2(instance_t* data)
 			auto p = obs_properties_add_int_slider(grp, ST_KEY_FFMPEG_THREADS, D_TRANSLATE(ST_I18N_FFMPEG_THREADS), 0,
 												   static_cast<int64_t>(std::thread::hardware_concurrency()) * 2, 1);
 		}
+
+		if (!_handler || !_handler->is_hardware_encoder(this)) {
+			auto p = obs_properties_add_bool(grp, ST_KEY_FFMPEG_ASYNC, D_TRANSLATE(ST_I18N_FFMPEG_ASYNC));
+		}
+
+		if (!_handler || !_handler->is_hardware_encoder(this)) {
+			auto p = obs_properties_add_bool(grp, ST_KEY_FFMPEG_SHAREDSCALING,
+											 D_TRANSLATE(ST_I18N_FFMPEG_SHAREDSCALING));
+		}
+
+		if (_handler && _handler->has_frame_parallel_support(this)) {
+			auto p = obs_properties_add_bool(grp, ST_KEY_FFMPEG_FRAMEPARALLEL,
+											 D_TRANSLATE(ST_I18N_FFMPEG_FRAMEPARALLEL));
+		}
 	};
 
 	return props;
@@ -22,6 +22,7 @@
 #pragma once
 #include "common.hpp"
 #include <condition_variable>
+#include <deque>
 #include <map>
 #include <mutex>
 #include <queue>
@@ -30,9 +31,11 @@
 #include <vector>
 #include "ffmpeg/avframe-queue.hpp"
 #include "ffmpeg/hwapi/base.hpp"
+#include "ffmpeg/scaling-pyramid.hpp"
 #include "ffmpeg/swscale.hpp"
 #include "handlers/handler.hpp"
 #include "obs/obs-encoder-factory.hpp"
+#include "util/util-profiler.hpp"
 
 extern "C" {
 #ifdef _MSC_VER
@@ -60,6 +63,10 @@ namespace streamfx::encoder::ffmpeg {
 		::streamfx::ffmpeg::swscale _scaler;
 		AVPacket                    _packet;
 
+		// Shared Scaling, replaces the scaler with a rendition of the input shared with other encoders.
+		std::shared_ptr<::streamfx::ffmpeg::scaling_pyramid> _pyramid;
+		std::size_t                                          _pyramid_consumer;
+
 		std::shared_ptr<::streamfx::ffmpeg::hwapi::base>     _hwapi;
 		std::shared_ptr<::streamfx::ffmpeg::hwapi::instance> _hwinst;
 
@@ -75,6 +82,52 @@ namespace streamfx::encoder::ffmpeg {
 		std::stack<std::shared_ptr<AVFrame>>           _free_frames;
 		std::queue<std::shared_ptr<AVFrame>>           _used_frames;
 		std::chrono::high_resolution_clock::time_point _free_frames_last_used;
+		std::mutex                                     _free_frames_lock;
+
+		// Asynchronous Encoding
+		bool                                  _async;
+		std::thread                           _async_thread;
+		std::mutex                            _async_lock;
+		std::mutex                            _async_context_lock; // Held while encoding on _context, or updating it.
+		std::condition_variable               _async_work;         // Frames were queued, or the thread should stop.
+		std::condition_variable               _async_space;        // The input queue has room again.
+		std::deque<std::shared_ptr<AVFrame>>  _async_input;
+		std::deque<std::shared_ptr<AVPacket>> _async_output;
+		std::shared_ptr<AVPacket>             _async_packet; // Handed to OBS, must stay valid until the next call.
+		bool                                  _async_shutdown;
+		int                                   _async_error;
+		std::size_t                           _async_input_peak;
+		std::size_t                           _async_output_peak;
+
+		// Frame-Parallel Encoding, one context per worker for codecs which encode every frame on its own. Shares the
+		// lock, error, output packet and wake up of asynchronous encoding. Each context has its own queue of frames,
+		// which a single task drains, so that no worker ever waits for a context that is busy.
+		struct parallel_context {
+			AVCodecContext*                                            context;
+			std::deque<std::pair<uint64_t, std::shared_ptr<AVFrame>>> queue;   // Frames by submission order.
+			bool                                                       running; // A task is draining the queue.
+		};
+		std::vector<std::unique_ptr<parallel_context>> _parallel;
+		std::map<uint64_t, std::shared_ptr<AVPacket>>  _parallel_done; // Finished packets, by submission order.
+		uint64_t                                       _parallel_submitted;
+		uint64_t                                       _parallel_emitted;
+		std::size_t                                    _parallel_pending; // Frames still being encoded.
+
+		// Encode directly from the memory of OBS instead of a copy.
+		bool _wrap_frames;
+
+		// Time the graphics context was held for the current frame.
+		std::chrono::nanoseconds _graphics_held;
+
+#ifdef ENABLE_PROFILING
+		std::shared_ptr<streamfx::util::profiler> _profiler_copy;
+		std::shared_ptr<streamfx::util::profiler> _profiler_convert;
+		std::shared_ptr<streamfx::util::profiler> _profiler_encode;
+		std::shared_ptr<streamfx::util::profiler> _profiler_latency;
+		std::shared_ptr<streamfx::util::profiler> _profiler_graphics;
+
+		std::map<int64_t, std::chrono::steady_clock::time_point> _async_submitted;
+#endif
 
 		public:
 		ffmpeg_instance(obs_data_t* settings, obs_encoder_t* self, bool is_hw);
@@ -103,6 +156,7 @@ namespace streamfx::encoder::ffmpeg {
 		public:
 		void initialize_sw(obs_data_t* settings);
 		void initialize_hw(obs_data_t* settings);
+		void initialize_parallel(std::size_t count);
 
 		void                     push_free_frame(std::shared_ptr<AVFrame> frame);
 		std::shared_ptr<AVFrame> pop_free_frame();
@@ -110,12 +164,35 @@ namespace streamfx::encoder::ffmpeg {
 		void                     push_used_frame(std::shared_ptr<AVFrame> frame);
 		std::shared_ptr<AVFrame> pop_used_frame();
 
+		bool                     can_wrap_frame(struct encoder_frame* frame);
+		std::shared_ptr<AVFrame> wrap_frame(struct encoder_frame* frame);
+
 		int receive_packet(bool* received_packet, struct encoder_packet* packet);
 
+		/** Extract headers and let the handler post-process, on the thread which owns 'context'. */
+		void prepare_packet(AVPacket& avpacket, AVCodecContext* context);
+
+		/** Hand a prepared packet to OBS. */
+		void process_packet(AVPacket& avpacket, struct encoder_packet* packet, bool* received_packet);
+
 		int send_frame(std::shared_ptr<AVFrame> frame);
 
 		bool encode_avframe(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet, bool* received_packet);
 
+		bool encode_avframe_async(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet,
+								  bool* received_packet);
+
+		bool encode_avframe_parallel(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet,
+									 bool* received_packet);
+
+		private:
+		void async_main();
+
+		int async_drain();
+
+		void parallel_drain(parallel_context* slot);
+		void parallel_abandon(parallel_context* slot);
+
 		public: // Handler API
 		bool is_hardware_encode();
 
@@ -124,6 +201,28 @@ namespace streamfx::encoder::ffmpeg {
 		const AVCodecContext* get_avcodeccontext();
 
 		void parse_ffmpeg_commandline(std::string_view text);
+
+#ifdef ENABLE_PROFILING
+		public: // Profiling
+		/** Time spent copying or converting the input frame. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_copy();
+
+		/** Time spent submitting frames to and retrieving packets from the encoder. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_encode();
+
+		/** Time spent converting the input frame to the encoder format, a subset of the copy time. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_convert();
+
+		/** Time from submitting a frame until its packet is handed to OBS, only with asynchronous encoding. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_latency();
+
+		/** Time the graphics context was held per frame, which is only needed for hardware encoding. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler_graphics();
+#endif
+
+		public:
+		/** Frames waiting for the encoder thread or contexts, and packets waiting for OBS. */
+		std::pair<std::size_t, std::size_t> get_queue_depth();
 	};
 
 	class ffmpeg_factory : public obs::encoder_factory<ffmpeg_factory, ffmpeg_instance> {
@@ -53,6 +53,11 @@ bool dnxhd_handler::has_pixel_format_support(ffmpeg_factory* instance)
 	return false;
 }
 
+bool dnxhd_handler::has_frame_parallel_support(ffmpeg_factory* instance)
+{
+	return true;
+}
+
 inline const char* dnx_profile_to_display_name(const char* profile)
 {
 	char buffer[1024];
@@ -44,6 +44,11 @@ bool handler::handler::has_pixel_format_support(ffmpeg_factory* instance)
 	return (instance->get_avcodec()->pix_fmts != nullptr);
 }
 
+bool handler::handler::has_frame_parallel_support(ffmpeg_factory* instance)
+{
+	return false;
+}
+
 bool handler::handler::supports_reconfigure(ffmpeg_factory* instance, bool& threads, bool& gpu, bool& keyframes)
 {
 	return false;
@@ -61,6 +61,9 @@ namespace streamfx::encoder::ffmpeg {
 
 			virtual bool has_pixel_format_support(ffmpeg_factory* instance);
 
+			/** Whether every frame is encoded on its own, so that several contexts may encode frames in parallel. */
+			virtual bool has_frame_parallel_support(ffmpeg_factory* instance);
+
 			virtual bool supports_reconfigure(ffmpeg_factory* instance, bool& threads, bool& gpu, bool& keyframes);
 
 			public /*settings*/:
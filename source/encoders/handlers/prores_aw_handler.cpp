@@ -61,6 +61,11 @@ bool prores_aw_handler::has_pixel_format_support(ffmpeg_factory* instance)
 	return false;
 }
 
+bool prores_aw_handler::has_frame_parallel_support(ffmpeg_factory* instance)
+{
+	return true;
+}
+
 inline const char* profile_to_name(const AVProfile* ptr)
 {
 	switch (static_cast<profile>(ptr->profile)) {
@@ -0,0 +1,320 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "scaling-pyramid.hpp"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include "plugin.hpp"
+#include "tools.hpp"
+
+// Frames kept per rendition for re-use. Encoders with a lot of delay hold on to more, which are then allocated.
+#define ST_PYRAMID_POOL 32
+
+using namespace streamfx::ffmpeg;
+
+scaling_pyramid::scaling_pyramid(uint32_t width, uint32_t height, AVPixelFormat format, bool full_range,
+								 AVColorSpace colorspace)
+	: _lock(), _built(), _width(width), _height(height), _format(format), _full_range(full_range),
+	  _colorspace(colorspace), _levels(), _consumers(), _consumers_next(0), _timestamp(0), _valid(false),
+	  _building(false)
+{}
+
+scaling_pyramid::~scaling_pyramid() = default;
+
+std::size_t scaling_pyramid::add(uint32_t width, uint32_t height, AVPixelFormat format)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_built.wait(lock, [this]() { return !_building; });
+
+	auto found = std::find_if(_levels.begin(), _levels.end(), [width, height, format](std::unique_ptr<level>& entry) {
+		return (entry->width == width) && (entry->height == height) && (entry->format == format);
+	});
+
+	level* target = nullptr;
+	if (found != _levels.end()) {
+		target = found->get();
+		target->users++;
+	} else {
+		auto entry    = std::make_unique<level>();
+		entry->width  = width;
+		entry->height = height;
+		entry->format = format;
+		entry->users  = 1;
+		entry->parent = nullptr;
+#ifdef ENABLE_PROFILING
+		entry->profiler = streamfx::util::profiler::create();
+#endif
+		target = entry.get();
+		_levels.push_back(std::move(entry));
+
+		if (!rebuild()) {
+			_levels.erase(std::find_if(_levels.begin(), _levels.end(),
+									   [target](std::unique_ptr<level>& entry) { return entry.get() == target; }));
+			rebuild();
+			throw std::runtime_error("Failed to initialize scaler for rendition.");
+		}
+	}
+
+	std::size_t id = _consumers_next++;
+	_consumers.emplace(id, consumer{target});
+	return id;
+}
+
+void scaling_pyramid::remove(std::size_t id)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_built.wait(lock, [this]() { return !_building; });
+
+	auto kv = _consumers.find(id);
+	if (kv == _consumers.end()) {
+		return;
+	}
+	level* target = kv->second.target;
+	_consumers.erase(kv);
+
+	if (--target->users == 0) {
+		_levels.erase(std::find_if(_levels.begin(), _levels.end(),
+								   [target](std::unique_ptr<level>& entry) { return entry.get() == target; }));
+		rebuild(); // Only ever removes or reuses scalers which worked before.
+	}
+}
+
+std::size_t scaling_pyramid::size()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	return _levels.size();
+}
+
+std::shared_ptr<AVFrame> scaling_pyramid::convert(std::size_t id, uint64_t timestamp, const uint8_t* const data[],
+												   const int stride[])
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_built.wait(lock, [this]() { return !_building; });
+
+	auto kv = _consumers.find(id);
+	if (kv == _consumers.end()) {
+		return nullptr;
+	}
+	level* target = kv->second.target;
+
+	if (!_valid || (_timestamp != timestamp)) {
+		// Build without the lock, so that nobody waits on it for longer than it takes to hand out a result. Levels
+		// don't change until the build finished, and the results are only published once they are all done.
+		std::vector<level*> levels;
+		for (auto& entry : _levels) {
+			levels.push_back(entry.get());
+		}
+		std::vector<std::shared_ptr<AVFrame>> frames(levels.size());
+
+		_building = true;
+		_valid    = false;
+		lock.unlock();
+
+		bool success = false;
+		try {
+			success = build(levels, frames, data, stride);
+		} catch (...) {
+			lock.lock();
+			_building = false;
+			_built.notify_all();
+			throw;
+		}
+
+		lock.lock();
+		_building = false;
+		if (success) {
+			for (std::size_t idx = 0; idx < levels.size(); idx++) {
+				levels[idx]->frame = frames[idx];
+			}
+			_timestamp = timestamp;
+			_valid     = true;
+		}
+		_built.notify_all();
+
+		if (!success) {
+			return nullptr;
+		}
+	}
+
+	// Every consumer gets its own frame, as timestamps differ between encoders. The buffers are shared.
+	return std::shared_ptr<AVFrame>(av_frame_clone(target->frame.get()), [](AVFrame* frame) {
+		av_frame_unref(frame);
+		av_frame_free(&frame);
+	});
+}
+
+#ifdef ENABLE_PROFILING
+std::shared_ptr<streamfx::util::profiler> scaling_pyramid::get_profiler(std::size_t id)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	if (auto kv = _consumers.find(id); kv != _consumers.end()) {
+		return kv->second.target->profiler;
+	}
+	return nullptr;
+}
+#endif
+
+bool scaling_pyramid::rebuild()
+{
+	std::stable_sort(_levels.begin(), _levels.end(), [](std::unique_ptr<level>& a, std::unique_ptr<level>& b) {
+		return (uint64_t(a->width) * a->height) > (uint64_t(b->width) * b->height);
+	});
+
+	// Scaling everything from the largest rendition keeps the smaller ones independent of each other.
+	level* largest = _levels.empty() ? nullptr : _levels.front().get();
+	bool   success = true;
+	for (auto& entry : _levels) {
+		level* parent = nullptr;
+		if ((entry.get() != largest) && (largest->format == entry->format) && (largest->width >= entry->width)
+			&& (largest->height >= entry->height)) {
+			parent = largest;
+		}
+
+		entry->parent = parent;
+		entry->frame  = nullptr;
+
+		auto& scaler = entry->scaler;
+		scaler.finalize();
+		if (parent) {
+			scaler.set_source_size(parent->width, parent->height);
+			scaler.set_source_format(parent->format);
+		} else {
+			scaler.set_source_size(_width, _height);
+			scaler.set_source_format(_format);
+		}
+		scaler.set_source_color(_full_range, _colorspace);
+		scaler.set_target_size(entry->width, entry->height);
+		scaler.set_target_format(entry->format);
+		scaler.set_target_color(_full_range, _colorspace);
+
+		bool resize = (scaler.get_source_width() != entry->width) || (scaler.get_source_height() != entry->height);
+		if (!scaler.initialize(resize ? SWS_BILINEAR : SWS_POINT)) {
+			success = false;
+		}
+	}
+
+	// Nothing has been built with the new layout yet.
+	_valid = false;
+	return success;
+}
+
+bool scaling_pyramid::build(const std::vector<level*>& levels, std::vector<std::shared_ptr<AVFrame>>& frames,
+							const uint8_t* const data[], const int stride[])
+{
+	std::atomic<bool> success{true};
+
+	auto build_level = [this, &levels, &frames, data, stride, &success](std::size_t index) {
+		level& entry = *levels[index];
+#ifdef ENABLE_PROFILING
+		auto profile = entry.profiler->track();
+#endif
+		// Encoders may still reference older results, which must not change underneath them.
+		std::shared_ptr<AVFrame> frame;
+		for (auto& pooled : entry.pool) {
+			if (av_frame_is_writable(pooled.get())) {
+				frame = pooled;
+				break;
+			}
+		}
+		if (!frame) {
+			frame = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* frame) {
+				av_frame_unref(frame);
+				av_frame_free(&frame);
+			});
+			frame->width  = static_cast<int>(entry.width);
+			frame->height = static_cast<int>(entry.height);
+			frame->format = entry.format;
+			if (int res = av_frame_get_buffer(frame.get(), 32); res < 0) {
+				throw std::runtime_error(tools::get_error_description(res));
+			}
+			if (entry.pool.size() < ST_PYRAMID_POOL) {
+				entry.pool.push_back(frame);
+			}
+		}
+
+		int32_t res = 0;
+		if (entry.parent) {
+			// Parents are built in the first pass, so their results are already here.
+			auto& parent = frames[static_cast<std::size_t>(
+				std::distance(levels.begin(), std::find(levels.begin(), levels.end(), entry.parent)))];
+			if (!parent) {
+				success = false;
+				return;
+			}
+			res = entry.scaler.convert(parent->data, parent->linesize, 0, static_cast<int32_t>(entry.parent->height),
+									   frame->data, frame->linesize);
+		} else {
+			res = entry.scaler.convert(data, stride, 0, static_cast<int32_t>(_height), frame->data, frame->linesize);
+		}
+		if (res <= 0) {
+			success = false;
+		}
+		frames[index] = frame;
+	};
+
+	// Renditions converted from the input first, then all those scaled down from the largest one.
+	for (bool from_input : {true, false}) {
+		std::vector<std::size_t> work;
+		for (std::size_t idx = 0; idx < levels.size(); idx++) {
+			if ((levels[idx]->parent == nullptr) == from_input) {
+				work.push_back(idx);
+			}
+		}
+		streamfx::threadpool()->parallel_for(0, work.size(), 1,
+											 [&work, &build_level](std::size_t begin, std::size_t end) {
+												 for (std::size_t idx = begin; idx < end; idx++) {
+													 build_level(work[idx]);
+												 }
+											 });
+	}
+
+	return success;
+}
+
+std::shared_ptr<scaling_pyramid> scaling_pyramid::get(const void* video, uint32_t width, uint32_t height,
+													  AVPixelFormat format, bool full_range, AVColorSpace colorspace)
+{
+	static std::mutex                                                                      lock;
+	static std::map<std::pair<const void*, AVPixelFormat>, std::weak_ptr<scaling_pyramid>> pyramids;
+
+	std::unique_lock<std::mutex> ulock(lock);
+
+	// Forget about pyramids nobody uses anymore.
+	for (auto kv = pyramids.begin(); kv != pyramids.end();) {
+		if (kv->second.expired()) {
+			kv = pyramids.erase(kv);
+		} else {
+			kv++;
+		}
+	}
+
+	auto key = std::make_pair(video, format);
+	if (auto kv = pyramids.find(key); kv != pyramids.end()) {
+		if (auto pyramid = kv->second.lock(); pyramid) {
+			return pyramid;
+		}
+	}
+
+	auto pyramid = std::make_shared<scaling_pyramid>(width, height, format, full_range, colorspace);
+	pyramids.emplace(key, pyramid);
+	return pyramid;
+}
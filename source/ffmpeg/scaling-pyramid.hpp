@@ -0,0 +1,129 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include "common.hpp"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "swscale.hpp"
+#include "util/util-profiler.hpp"
+
+extern "C" {
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4242 4244 4365)
+#endif
+#include <libavutil/frame.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+}
+
+namespace streamfx::ffmpeg {
+	/** Converts and scales every input frame once for all encoders which share the same video.
+	 *
+	 * The largest rendition is converted from the input, and all smaller renditions in the same format are scaled
+	 * down from it in parallel. Renditions in another format are converted from the input instead.
+	 *
+	 * libOBS hands the same frame to every encoder on a video in turn, so the first encoder to ask for a new frame
+	 * builds all renditions, and the others pick up the result. Frames are told apart by their timestamp, which must
+	 * be the same for every encoder, and renditions are built without holding the lock.
+	 */
+	class scaling_pyramid {
+		struct level {
+			uint32_t      width;
+			uint32_t      height;
+			AVPixelFormat format;
+			std::size_t   users;
+			level*        parent; // Scaled from this level, or from the input if null.
+
+			::streamfx::ffmpeg::swscale           scaler;
+			std::shared_ptr<AVFrame>              frame; // Result for the current timestamp.
+			std::vector<std::shared_ptr<AVFrame>> pool;  // Frames which may be written again once encoders let go.
+#ifdef ENABLE_PROFILING
+			std::shared_ptr<streamfx::util::profiler> profiler;
+#endif
+		};
+
+		struct consumer {
+			level* target;
+		};
+
+		std::mutex              _lock;
+		std::condition_variable _built; // Signalled once a build finished.
+
+		uint32_t      _width;
+		uint32_t      _height;
+		AVPixelFormat _format;
+		bool          _full_range;
+		AVColorSpace  _colorspace;
+
+		std::vector<std::unique_ptr<level>> _levels; // Largest first.
+		std::map<std::size_t, consumer>     _consumers;
+		std::size_t                         _consumers_next;
+
+		uint64_t _timestamp; // Input the results of every level were built from.
+		bool     _valid;     // False if nothing was built with the current layout yet.
+		bool     _building;  // Levels must not change until the build finished.
+
+		public:
+		scaling_pyramid(uint32_t width, uint32_t height, AVPixelFormat format, bool full_range,
+						AVColorSpace colorspace);
+		~scaling_pyramid();
+
+		/** Add a rendition, and return the consumer id for it. Renditions of the same size and format are shared. */
+		std::size_t add(uint32_t width, uint32_t height, AVPixelFormat format);
+
+		void remove(std::size_t id);
+
+		/** Number of distinct renditions. */
+		std::size_t size();
+
+		/** Retrieve the rendition of the given input frame for a consumer.
+		 *
+		 * The returned frame references shared buffers, which must not be written to.
+		 *
+		 * @param timestamp Identifies the input frame, and must be the same for every consumer that converts it.
+		 * @return The converted frame, or nullptr if conversion failed.
+		 */
+		std::shared_ptr<AVFrame> convert(std::size_t id, uint64_t timestamp, const uint8_t* const data[],
+										 const int stride[]);
+
+#ifdef ENABLE_PROFILING
+		/** Time spent converting or scaling the rendition of a consumer, regardless of which consumer did it. */
+		std::shared_ptr<streamfx::util::profiler> get_profiler(std::size_t id);
+#endif
+
+		private:
+		bool rebuild();
+
+		bool build(const std::vector<level*>& levels, std::vector<std::shared_ptr<AVFrame>>& frames,
+				   const uint8_t* const data[], const int stride[]);
+
+		public:
+		/** Retrieve the pyramid for a video and input format, or create it if there is none. */
+		static std::shared_ptr<scaling_pyramid> get(const void* video, uint32_t width, uint32_t height,
+													AVPixelFormat format, bool full_range, AVColorSpace colorspace);
+	};
+} // namespace streamfx::ffmpeg
@@ -20,7 +20,23 @@
 // SOFTWARE.
 
 #include "swscale.hpp"
+#include <algorithm>
 #include <stdexcept>
+#include "plugin.hpp"
+
+extern "C" {
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4242 4244 4365)
+#endif
+#include <libavutil/pixdesc.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+}
+
+// Slices smaller than this are not worth the extra context.
+#define ST_SLICE_ROWS_MINIMUM 128
 
 using namespace streamfx::ffmpeg;
 
@@ -183,11 +199,57 @@ bool swscale::initialize(int flags)
 							 sws_getCoefficients(target_colorspace), target_full_range ? 1 : 0, 1L << 16 | 0L,
 							 1L << 16 | 0L, 1L << 16 | 0L);
 
+	// Without vertical scaling, every band of rows can be converted on its own. Vertical chroma resampling (for
+	// example 4:2:0 to 4:2:2) filters across rows and would treat the edge of each band as the edge of the frame, so
+	// that is only sliced if the filter never reads neighbouring rows.
+	const AVPixFmtDescriptor* source_desc   = av_pix_fmt_desc_get(source_format);
+	const AVPixFmtDescriptor* target_desc   = av_pix_fmt_desc_get(target_format);
+	int                       source_chroma = source_desc ? source_desc->log2_chroma_h : 0;
+	int                       target_chroma = target_desc ? target_desc->log2_chroma_h : 0;
+	bool                      independent   = ((flags & SWS_POINT) != 0) || (source_chroma == target_chroma);
+	if (auto pool = streamfx::threadpool(); pool && independent && (source_size.second == target_size.second)) {
+		uint32_t align = 1u << std::max(source_chroma, target_chroma);
+
+		std::size_t count = std::min<std::size_t>(pool->size(), source_size.second / ST_SLICE_ROWS_MINIMUM);
+		if (count > 1) {
+			uint32_t rows = static_cast<uint32_t>(((source_size.second / count) + align - 1) & ~(align - 1));
+			for (uint32_t row = 0; row < source_size.second; row += rows) {
+				slice entry;
+				entry.row     = row;
+				entry.rows    = std::min(rows, source_size.second - row);
+				entry.context = sws_getContext(static_cast<int>(source_size.first), static_cast<int>(entry.rows),
+											   source_format, static_cast<int>(target_size.first),
+											   static_cast<int>(entry.rows), target_format, flags, nullptr, nullptr,
+											   nullptr);
+				if (!entry.context) {
+					break;
+				}
+				sws_setColorspaceDetails(entry.context, sws_getCoefficients(source_colorspace),
+										 source_full_range ? 1 : 0, sws_getCoefficients(target_colorspace),
+										 target_full_range ? 1 : 0, 1L << 16 | 0L, 1L << 16 | 0L, 1L << 16 | 0L);
+				slices.push_back(entry);
+			}
+
+			// Partially sliced frames are useless, so fall back to the single context instead.
+			if ((slices.size() < 2) || ((slices.back().row + slices.back().rows) != source_size.second)) {
+				for (auto& entry : slices) {
+					sws_freeContext(entry.context);
+				}
+				slices.clear();
+			}
+		}
+	}
+
 	return true;
 }
 
 bool swscale::finalize()
 {
+	for (auto& entry : slices) {
+		sws_freeContext(entry.context);
+	}
+	slices.clear();
+
 	if (this->context) {
 		sws_freeContext(this->context);
 		this->context = nullptr;
@@ -196,12 +258,60 @@ bool swscale::finalize()
 	return false;
 }
 
+std::size_t swscale::get_slices()
+{
+	return std::max<std::size_t>(slices.size(), 1);
+}
+
 int32_t swscale::convert(const uint8_t* const source_data[], const int source_stride[], int32_t source_row,
 						 int32_t source_rows, uint8_t* const target_data[], const int target_stride[])
 {
 	if (!this->context) {
 		return 0;
 	}
+
+	// Convert whole frames slice by slice on the thread pool.
+	if ((slices.size() > 1) && (source_row == 0) && (static_cast<uint32_t>(source_rows) == source_size.second)) {
+		const AVPixFmtDescriptor* source_desc   = av_pix_fmt_desc_get(source_format);
+		const AVPixFmtDescriptor* target_desc   = av_pix_fmt_desc_get(target_format);
+		int                       source_chroma = source_desc ? source_desc->log2_chroma_h : 0;
+		int                       target_chroma = target_desc ? target_desc->log2_chroma_h : 0;
+		std::atomic<int32_t>      height{0};
+		std::atomic<int32_t>      error{0};
+
+		streamfx::threadpool()->parallel_for(0, slices.size(), 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t idx = begin; idx < end; idx++) {
+				auto&          entry = slices[idx];
+				const uint8_t* source[4]{};
+				uint8_t*       target[4]{};
+
+				// Only the chroma planes (1 and 2) are subsampled, luma and alpha are always at full resolution.
+				for (std::size_t plane = 0; plane < 4; plane++) {
+					bool is_chroma = (plane == 1) || (plane == 2);
+					if (source_data[plane]) {
+						source[plane] = source_data[plane]
+										+ static_cast<ptrdiff_t>(source_stride[plane])
+											  * (entry.row >> (is_chroma ? source_chroma : 0));
+					}
+					if (target_data[plane]) {
+						target[plane] = target_data[plane]
+										+ static_cast<ptrdiff_t>(target_stride[plane])
+											  * (entry.row >> (is_chroma ? target_chroma : 0));
+					}
+				}
+
+				int res = sws_scale(entry.context, source, source_stride, 0, static_cast<int>(entry.rows), target,
+									target_stride);
+				if (res < 0) {
+					error = res;
+				} else {
+					height += res;
+				}
+			}
+		});
+		return (error.load() < 0) ? error.load() : height.load();
+	}
+
 	int height =
 		sws_scale(this->context, source_data, source_stride, source_row, source_rows, target_data, target_stride);
 	return height;
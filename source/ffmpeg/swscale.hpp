@@ -22,6 +22,7 @@
 #pragma once
 #include "common.hpp"
 #include <utility>
+#include <vector>
 
 extern "C" {
 #ifdef _MSC_VER
@@ -49,6 +50,14 @@ namespace streamfx::ffmpeg {
 
 		SwsContext* context = nullptr;
 
+		// Horizontal bands of the frame, each with their own context so that they can be converted in parallel.
+		struct slice {
+			SwsContext* context;
+			uint32_t    row;
+			uint32_t    rows;
+		};
+		std::vector<slice> slices;
+
 		public:
 		swscale();
 		~swscale();
@@ -82,6 +91,9 @@ namespace streamfx::ffmpeg {
 		bool initialize(int flags);
 		bool finalize();
 
+		/** Number of slices a whole frame is converted in, 1 if it is converted in one go. */
+		std::size_t get_slices();
+
 		int32_t convert(const uint8_t* const source_data[], const int source_stride[], int32_t source_row,
 						int32_t source_rows, uint8_t* const target_data[], const int target_stride[]);
 	};
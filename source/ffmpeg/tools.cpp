@@ -102,6 +102,26 @@ static std::map<video_format, AVPixelFormat> const obs_to_av_format_map = {
 	{VIDEO_FORMAT_I42A, AV_PIX_FMT_YUVA422P}, //
 	{VIDEO_FORMAT_YUVA, AV_PIX_FMT_YUVA444P}, //
 											  //{VIDEO_FORMAT_AYUV, AV_PIX_FMT_AYUV444P}, //
+#if LIBOBS_API_MAJOR_VER >= 28
+	{VIDEO_FORMAT_P010, AV_PIX_FMT_P010LE},      // P010 Packed YUV, 10-bit
+	{VIDEO_FORMAT_I010, AV_PIX_FMT_YUV420P10LE}, // YUV 4:2:0, 10-bit
+	{VIDEO_FORMAT_I210, AV_PIX_FMT_YUV422P10LE}, // YUV 4:2:2, 10-bit
+	{VIDEO_FORMAT_I412, AV_PIX_FMT_YUV444P12LE}, // YUV 4:4:4, 12-bit
+#endif
+};
+
+// Color formats which libOBS converts to on the GPU, before the frame is read back.
+static const AVPixelFormat obs_gpu_formats[] = {
+	AV_PIX_FMT_NV12,
+	AV_PIX_FMT_YUV420P,
+	AV_PIX_FMT_YUV444P,
+#if LIBOBS_API_MAJOR_VER >= 28
+	AV_PIX_FMT_P010LE,
+	AV_PIX_FMT_YUV420P10LE,
+	AV_PIX_FMT_YUV422P10LE,
+	AV_PIX_FMT_YUV444P12LE,
+#endif
+	AV_PIX_FMT_NONE,
 };
 
 AVPixelFormat tools::obs_videoformat_to_avpixelformat(video_format v)
@@ -128,6 +148,11 @@ AVPixelFormat tools::get_least_lossy_format(const AVPixelFormat* haystack, AVPix
 	return avcodec_find_best_pix_fmt_of_list(haystack, needle, 0, &data_loss);
 }
 
+video_format tools::get_closest_gpu_videoformat(AVPixelFormat v)
+{
+	return avpixelformat_to_obs_videoformat(get_least_lossy_format(obs_gpu_formats, v));
+}
+
 AVColorRange tools::obs_to_av_color_range(video_range_type v)
 {
 	switch (v) {
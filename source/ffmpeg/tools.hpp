@@ -48,6 +48,9 @@ namespace streamfx::ffmpeg::tools {
 
 	AVPixelFormat get_least_lossy_format(const AVPixelFormat* haystack, AVPixelFormat needle);
 
+	/** Color format which libOBS can convert to on the GPU that is closest to 'v', or VIDEO_FORMAT_NONE. */
+	video_format get_closest_gpu_videoformat(AVPixelFormat v);
+
 	AVColorRange                  obs_to_av_color_range(video_range_type v);
 	AVColorSpace                  obs_to_av_color_space(video_colorspace v);
 	AVColorPrimaries              obs_to_av_color_primary(video_colorspace v);
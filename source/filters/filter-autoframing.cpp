@@ -149,15 +149,15 @@ autoframing_instance::~autoframing_instance()
 	D_LOG_DEBUG("Finalizing... (Addr: 0x%" PRIuPTR ")", this);
 
 	{ // Unload the underlying effect ASAP.
-		std::unique_lock<std::mutex> ul(_provider_lock);
-
-		// De-queue the underlying task.
+		// Drop any queued provider switches, and wait for the one in progress to finish.
+		_provider_token->cancel();
 		if (_provider_task) {
-			streamfx::threadpool()->pop(_provider_task);
 			_provider_task->await_completion();
 			_provider_task.reset();
 		}
 
+		std::unique_lock<std::mutex> ul(_provider_lock);
+
 		// TODO: Make this asynchronous.
 		switch (_provider) {
 #ifdef ENABLE_FILTER_DENOISING_NVIDIA
@@ -179,7 +179,7 @@ autoframing_instance::autoframing_instance(obs_data_t* data, obs_source_t* self)
 	  _gfx_debug(), _standard_effect(), _input(), _vb(),
 
 	  _provider(tracking_provider::INVALID), _provider_ui(tracking_provider::INVALID), _provider_ready(false),
-	  _provider_lock(), _provider_task(),
+	  _provider_lock(), _provider_task(), _provider_token(std::make_shared<util::threadpool::cancellation_token>()),
 
 	  _track_mode(tracking_mode::SOLO), _track_frequency(1),
 
@@ -863,34 +863,19 @@ void streamfx::filter::autoframing::autoframing_instance::switch_provider(tracki
 		return;
 	}
 
-	// This doesn't work correctly.
-	// - Need to allow multiple switches at once because OBS is weird.
-	// - Doesn't guarantee that the task is properly killed off.
-
 	// Log information.
 	D_LOG_INFO("Instance '%s' is switching provider from '%s' to '%s'.", obs_source_get_name(_self), cstring(_provider),
 			   cstring(provider));
 
-	// If there is an ongoing task to switch provider, cancel it.
-	if (_provider_task) {
-		// De-queue it.
-		streamfx::threadpool()->pop(_provider_task);
-
-		// Await the death of the task itself.
-		_provider_task->await_completion();
-
-		// Clear any memory associated with it.
-		_provider_task.reset();
-	}
-
 	// Build data to pass into the task.
 	auto spd      = std::make_shared<switch_provider_data_t>();
 	spd->provider = _provider;
 	_provider     = provider;
 
-	// Then spawn a new task to switch provider.
-	_provider_task = streamfx::threadpool()->push(
-		std::bind(&autoframing_instance::task_switch_provider, this, std::placeholders::_1), spd);
+	// Then queue a task to switch provider, which runs after any switch that is still in progress.
+	_provider_task = streamfx::threadpool()->then(
+		_provider_task, std::bind(&autoframing_instance::task_switch_provider, this, std::placeholders::_1), spd,
+		util::threadpool_priority::BACKGROUND, _provider_token);
 }
 
 void streamfx::filter::autoframing::autoframing_instance::task_switch_provider(util::threadpool_data_t data)
@@ -87,11 +87,12 @@ namespace streamfx::filter::autoframing {
 		std::shared_ptr<::streamfx::obs::gs::rendertarget>  _input;
 		std::shared_ptr<::streamfx::obs::gs::vertex_buffer> _vb;
 
-		tracking_provider                       _provider;
-		tracking_provider                       _provider_ui;
-		std::atomic<bool>                       _provider_ready;
-		std::mutex                              _provider_lock;
-		std::shared_ptr<util::threadpool::task> _provider_task;
+		tracking_provider                                     _provider;
+		tracking_provider                                     _provider_ui;
+		std::atomic<bool>                                     _provider_ready;
+		std::mutex                                            _provider_lock;
+		std::shared_ptr<util::threadpool::task>               _provider_task;
+		std::shared_ptr<util::threadpool::cancellation_token> _provider_token;
 
 #ifdef ENABLE_FILTER_AUTOFRAMING_NVIDIA
 		std::shared_ptr<::streamfx::nvidia::ar::facedetection> _nvidia_fx;
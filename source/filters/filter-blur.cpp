@@ -30,6 +30,7 @@
 #include "gfx/blur/gfx-blur-gaussian-linear.hpp"
 #include "gfx/blur/gfx-blur-gaussian.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/obs-source-tracker.hpp"
 #include "util/util-logging.hpp"
 
@@ -147,10 +148,6 @@ blur_instance::blur_instance(obs_data_t* settings, obs_source_t* self)
 	{
 		auto gctx = streamfx::obs::gs::context();
 
-		// Create RenderTargets
-		this->_source_rt = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		this->_output_rt = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-
 		// Load Effects
 		{
 			auto file = streamfx::data_file_path("effects/mask.effect");
@@ -366,13 +363,18 @@ void blur_instance::video_tick(float)
 	// Load Mask
 	if (_mask.type == mask_type::Image) {
 		if (_mask.image.path_old != _mask.image.path) {
+			// The previous image is used until the new one is loaded.
+			_mask.image.request  = streamfx::obs::gs::texture_loader::instance()->load(_mask.image.path);
+			_mask.image.path_old = _mask.image.path;
+		}
+		if (_mask.image.request && _mask.image.request->is_done()) {
 			try {
-				_mask.image.texture  = std::make_shared<streamfx::obs::gs::texture>(_mask.image.path);
-				_mask.image.path_old = _mask.image.path;
+				_mask.image.texture = _mask.image.request->get_texture();
 			} catch (...) {
 				DLOG_ERROR("<filter-blur> Instance '%s' failed to load image '%s'.", obs_source_get_name(_self),
 						   _mask.image.path.c_str());
 			}
+			_mask.image.request.reset();
 		}
 	} else if (_mask.type == mask_type::Source) {
 		if (_mask.source.name_old != _mask.source.name) {
@@ -388,8 +390,13 @@ void blur_instance::video_tick(float)
 		}
 	}
 
+	// Hand the render targets back, so that sources which are not shown don't hold on to them.
 	_source_rendered = false;
+	_source_texture.reset();
+	_source_rt.reset();
 	_output_rendered = false;
+	_output_texture.reset();
+	_output_rt.reset();
 }
 
 void blur_instance::video_render(gs_effect_t* effect)
@@ -420,7 +427,8 @@ void blur_instance::video_render(gs_effect_t* effect)
 
 			if (obs_source_process_filter_begin(this->_self, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
 				{
-					auto op = this->_source_rt->render(baseW, baseH);
+					_source_rt = streamfx::obs::gs::rendertarget_pool::instance()->acquire(baseW, baseH, GS_RGBA);
+					auto op    = this->_source_rt->render(baseW, baseH);
 
 					gs_blend_state_push();
 					gs_reset_blend_state();
@@ -543,7 +551,8 @@ void blur_instance::video_render(gs_effect_t* effect)
 			apply_mask_parameters(_effect_mask, _source_texture->get_object(), _output_texture->get_object());
 
 			try {
-				auto op = this->_output_rt->render(baseW, baseH);
+				_output_rt = streamfx::obs::gs::rendertarget_pool::instance()->acquire(baseW, baseH, GS_RGBA);
+				auto op    = this->_output_rt->render(baseW, baseH);
 				gs_ortho(0, 1, 0, 1, -1, 1);
 
 				// Render
@@ -28,6 +28,7 @@
 #include "obs/gs/gs-effect.hpp"
 #include "obs/gs/gs-helper.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
+#include "obs/gs/gs-texture-loader.hpp"
 #include "obs/gs/gs-texture.hpp"
 #include "obs/obs-source-factory.hpp"
 
@@ -42,7 +43,7 @@ namespace streamfx::filter::blur {
 		// Effects
 		streamfx::obs::gs::effect _effect_mask;
 
-		// Input
+		// Input, render targets are taken from the pool and only kept for the current frame.
 		std::shared_ptr<streamfx::obs::gs::rendertarget> _source_rt;
 		std::shared_ptr<streamfx::obs::gs::texture>      _source_texture;
 		bool                                             _source_rendered;
@@ -74,9 +75,10 @@ namespace streamfx::filter::blur {
 				bool    invert;
 			} region;
 			struct {
-				std::string                                 path;
-				std::string                                 path_old;
-				std::shared_ptr<streamfx::obs::gs::texture> texture;
+				std::string                                                 path;
+				std::string                                                 path_old;
+				std::shared_ptr<streamfx::obs::gs::texture>                 texture;
+				std::shared_ptr<streamfx::obs::gs::texture_loader::request> request;
 			} image;
 			struct {
 				std::string                                    name_old;
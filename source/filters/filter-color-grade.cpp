@@ -21,6 +21,7 @@
 #include "strings.hpp"
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "util/util-logging.hpp"
 
 #ifdef _DEBUG
@@ -355,6 +356,10 @@ void color_grade_instance::video_tick(float)
 {
 	_ccache_fresh = false;
 	_cache_fresh  = false;
+
+	// Hand the input cache back, so that sources which are not shown don't hold on to it.
+	_ccache_texture.reset();
+	_ccache_rt.reset();
 }
 
 void color_grade_instance::video_render(gs_effect_t* shader)
@@ -387,10 +392,8 @@ void color_grade_instance::video_render(gs_effect_t* shader)
 		streamfx::obs::gs::debug_marker gdmp{streamfx::obs::gs::debug_color_cache, "Cache '%s'",
 											 obs_source_get_name(target)};
 #endif
-		// If the input cache render target doesn't exist, create it.
-		if (!_ccache_rt) {
-			_ccache_rt = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		}
+		// The input cache is only needed for this frame, so take it from the pool.
+		_ccache_rt = streamfx::obs::gs::rendertarget_pool::instance()->acquire(width, height, GS_RGBA);
 
 		{
 			auto op = _ccache_rt->render(width, height);
@@ -403,7 +403,8 @@ void streamfx::filter::denoising::denoising_instance::switch_provider(denoising_
 
 	// Then spawn a new task to switch provider.
 	_provider_task = streamfx::threadpool()->push(
-		std::bind(&denoising_instance::task_switch_provider, this, std::placeholders::_1), spd);
+		std::bind(&denoising_instance::task_switch_provider, this, std::placeholders::_1), spd,
+		util::threadpool_priority::BACKGROUND);
 }
 
 void streamfx::filter::denoising::denoising_instance::task_switch_provider(util::threadpool_data_t data)
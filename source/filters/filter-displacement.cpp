@@ -100,19 +100,36 @@ void displacement_instance::update(obs_data_t* settings)
 	_scale[0] = _scale[1] = static_cast<float_t>(obs_data_get_double(settings, ST_KEY_SCALE));
 	_scale_type           = static_cast<float_t>(obs_data_get_double(settings, ST_KEY_SCALE_TYPE) / 100.0);
 
-	const char* new_file = obs_data_get_string(settings, ST_KEY_FILE);
+	// Settings are updated from the UI thread, while the request is picked up in video_tick().
+	std::unique_lock<std::mutex> lock(_texture_lock);
+	const char*                  new_file = obs_data_get_string(settings, ST_KEY_FILE);
 	if (new_file != _texture_file) {
-		try {
-			_texture      = std::make_shared<streamfx::obs::gs::texture>(new_file);
-			_texture_file = new_file;
-		} catch (...) {
-			_texture.reset();
+		// The previous displacement map is used until the new one is loaded, and dropped if there is none.
+		if (new_file[0] != '\0') {
+			_texture_request = streamfx::obs::gs::texture_loader::instance()->load(new_file);
+		} else {
+			_texture_request.reset();
 		}
+		_texture_file = new_file;
 	}
 }
 
 void displacement_instance::video_tick(float_t)
 {
+	std::unique_lock<std::mutex> lock(_texture_lock);
+	if (_texture_file.empty()) {
+		_texture.reset();
+	} else if (_texture_request && _texture_request->is_done()) {
+		try {
+			_texture = _texture_request->get_texture();
+		} catch (...) {
+			_texture.reset();
+			_texture_file.clear(); // Try again with the next update.
+		}
+		_texture_request.reset();
+	}
+	lock.unlock();
+
 	_width  = obs_source_get_base_width(_self);
 	_height = obs_source_get_base_height(_self);
 }
@@ -146,6 +163,7 @@ void displacement_instance::video_render(gs_effect_t*)
 
 std::string displacement_instance::get_file()
 {
+	std::unique_lock<std::mutex> lock(_texture_lock);
 	return _texture_file;
 }
 
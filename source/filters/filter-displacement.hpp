@@ -23,7 +23,9 @@
 
 #pragma once
 #include "common.hpp"
+#include <mutex>
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-texture-loader.hpp"
 #include "obs/obs-source-factory.hpp"
 
 namespace streamfx::filter::displacement {
@@ -31,10 +33,12 @@ namespace streamfx::filter::displacement {
 		streamfx::obs::gs::effect _effect;
 
 		// Displacement Map
-		std::shared_ptr<streamfx::obs::gs::texture> _texture;
-		std::string                                 _texture_file;
-		float_t                                     _scale[2];
-		float_t                                     _scale_type;
+		std::shared_ptr<streamfx::obs::gs::texture>                 _texture;
+		std::string                                                 _texture_file;
+		std::shared_ptr<streamfx::obs::gs::texture_loader::request> _texture_request;
+		std::mutex                                                  _texture_lock; // Guards file and request.
+		float_t                                                     _scale[2];
+		float_t                                                     _scale_type;
 
 		// Cache
 		uint32_t _width;
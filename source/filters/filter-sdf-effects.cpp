@@ -21,6 +21,7 @@
 #include "strings.hpp"
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "util/util-logging.hpp"
 
 #ifdef _DEBUG
@@ -128,15 +129,10 @@ sdf_effects_instance::sdf_effects_instance(obs_data_t* settings, obs_source_t* s
 		auto gctx        = streamfx::obs::gs::context();
 		vec4 transparent = {0, 0, 0, 0};
 
-		_source_rt = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		_sdf_write = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA32F, GS_ZS_NONE);
-		_sdf_read  = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA32F, GS_ZS_NONE);
-		_output_rt = std::make_shared<streamfx::obs::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-
-		std::shared_ptr<streamfx::obs::gs::rendertarget> initialize_rts[] = {_source_rt, _sdf_write, _sdf_read,
-																			 _output_rt};
-		for (auto rt : initialize_rts) {
-			auto op = rt->render(1, 1);
+		// The first distance field is produced from an empty one.
+		_sdf_read = streamfx::obs::gs::rendertarget_pool::instance()->acquire(1, 1, GS_RGBA32F);
+		{
+			auto op = _sdf_read->render(1, 1);
 			gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &transparent, 0, 0);
 		}
 
@@ -310,6 +306,12 @@ void sdf_effects_instance::video_tick(float_t)
 		_source_rendered = false;
 		_output_rendered = false;
 	}
+
+	// Hand the render targets back, so that sources which are not shown don't hold on to them.
+	_source_texture.reset();
+	_source_rt.reset();
+	_output_texture.reset();
+	_output_rt.reset();
 }
 
 void sdf_effects_instance::video_render(gs_effect_t* effect)
@@ -356,7 +358,8 @@ void sdf_effects_instance::video_render(gs_effect_t* effect)
 				streamfx::obs::gs::debug_marker gdm{streamfx::obs::gs::debug_color_cache, "Cache"};
 #endif
 
-				auto op = _source_rt->render(baseW, baseH);
+				_source_rt = streamfx::obs::gs::rendertarget_pool::instance()->acquire(baseW, baseH, GS_RGBA);
+				auto op    = _source_rt->render(baseW, baseH);
 				gs_ortho(0, static_cast<float>(baseW), 0, static_cast<float>(baseH), -1, 1);
 				gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &color_transparent, 0, 0);
 
@@ -393,13 +396,15 @@ void sdf_effects_instance::video_render(gs_effect_t* effect)
 					sdfH = 1.0;
 				}
 
+				auto sdf_write = streamfx::obs::gs::rendertarget_pool::instance()->acquire(
+					uint32_t(sdfW), uint32_t(sdfH), GS_RGBA32F);
 				{
 #ifdef ENABLE_PROFILING
 					streamfx::obs::gs::debug_marker gdm{streamfx::obs::gs::debug_color_convert,
 														"Update Distance Field"};
 #endif
 
-					auto op = _sdf_write->render(uint32_t(sdfW), uint32_t(sdfH));
+					auto op = sdf_write->render(uint32_t(sdfW), uint32_t(sdfH));
 					gs_ortho(0, 1, 0, 1, -1, 1);
 					gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &color_transparent, 0, 0);
 
@@ -412,7 +417,7 @@ void sdf_effects_instance::video_render(gs_effect_t* effect)
 						streamfx::gs_draw_fullscreen_tri();
 					}
 				}
-				std::swap(_sdf_read, _sdf_write);
+				_sdf_read = sdf_write;
 				_sdf_read->get_texture(_sdf_texture);
 				if (!_sdf_texture) {
 					throw std::runtime_error("SDF Backbuffer empty");
@@ -457,7 +462,8 @@ void sdf_effects_instance::video_render(gs_effect_t* effect)
 			streamfx::obs::gs::debug_marker gdm{streamfx::obs::gs::debug_color_convert, "Calculate"};
 #endif
 
-			auto op = _output_rt->render(baseW, baseH);
+			_output_rt = streamfx::obs::gs::rendertarget_pool::instance()->acquire(baseW, baseH, GS_RGBA);
+			auto op    = _output_rt->render(baseW, baseH);
 			gs_ortho(0, 1, 0, 1, 0, 1);
 
 			gs_enable_blending(false);
@@ -31,13 +31,12 @@ namespace streamfx::filter::sdf_effects {
 		streamfx::obs::gs::effect _sdf_producer_effect;
 		streamfx::obs::gs::effect _sdf_consumer_effect;
 
-		// Input
+		// Input, render targets are taken from the pool and only kept for the current frame.
 		std::shared_ptr<streamfx::obs::gs::rendertarget> _source_rt;
 		std::shared_ptr<streamfx::obs::gs::texture>      _source_texture;
 		bool                                             _source_rendered;
 
-		// Distance Field
-		std::shared_ptr<streamfx::obs::gs::rendertarget> _sdf_write;
+		// Distance Field, the previous one is kept around as it is used to produce the next.
 		std::shared_ptr<streamfx::obs::gs::rendertarget> _sdf_read;
 		std::shared_ptr<streamfx::obs::gs::texture>      _sdf_texture;
 		double_t                                         _sdf_scale;
@@ -93,7 +93,8 @@ upscaling_instance::upscaling_instance(obs_data_t* data, obs_source_t* self)
 	: obs::source_instance(data, self),
 
 	  _in_size(1, 1), _out_size(1, 1), _provider_ready(false), _provider(upscaling_provider::INVALID), _provider_lock(),
-	  _provider_task(), _input(), _output(), _dirty(false)
+	  _provider_task(), _provider_token(std::make_shared<util::threadpool::cancellation_token>()), _input(), _output(),
+	  _dirty(false)
 {
 	D_LOG_DEBUG("Initializating... (Addr: 0x%" PRIuPTR ")", this);
 
@@ -130,15 +131,15 @@ upscaling_instance::~upscaling_instance()
 	D_LOG_DEBUG("Finalizing... (Addr: 0x%" PRIuPTR ")", this);
 
 	{ // Unload the underlying effect ASAP.
-		std::unique_lock<std::mutex> ul(_provider_lock);
-
-		// De-queue the underlying task.
+		// Drop any queued provider switches, and wait for the one in progress to finish.
+		_provider_token->cancel();
 		if (_provider_task) {
-			streamfx::threadpool()->pop(_provider_task);
 			_provider_task->await_completion();
 			_provider_task.reset();
 		}
 
+		std::unique_lock<std::mutex> ul(_provider_lock);
+
 		// TODO: Make this asynchronous.
 		switch (_provider) {
 #ifdef ENABLE_FILTER_UPSCALING_NVIDIA
@@ -362,34 +363,19 @@ void streamfx::filter::upscaling::upscaling_instance::switch_provider(upscaling_
 		return;
 	}
 
-	// This doesn't work correctly.
-	// - Need to allow multiple switches at once because OBS is weird.
-	// - Doesn't guarantee that the task is properly killed off.
-
 	// Log information.
 	D_LOG_INFO("Instance '%s' is switching provider from '%s' to '%s'.", obs_source_get_name(_self), cstring(_provider),
 			   cstring(provider));
 
-	// If there is an existing task, attempt to cancel it.
-	if (_provider_task) {
-		// De-queue it.
-		streamfx::threadpool()->pop(_provider_task);
-
-		// Await the death of the task itself.
-		_provider_task->await_completion();
-
-		// Clear any memory associated with it.
-		_provider_task.reset();
-	}
-
 	// Build data to pass into the task.
 	auto spd      = std::make_shared<switch_provider_data_t>();
 	spd->provider = _provider;
 	_provider     = provider;
 
-	// Then spawn a new task to switch provider.
-	_provider_task = streamfx::threadpool()->push(
-		std::bind(&upscaling_instance::task_switch_provider, this, std::placeholders::_1), spd);
+	// Then queue a task to switch provider, which runs after any switch that is still in progress.
+	_provider_task = streamfx::threadpool()->then(
+		_provider_task, std::bind(&upscaling_instance::task_switch_provider, this, std::placeholders::_1), spd,
+		util::threadpool_priority::BACKGROUND, _provider_token);
 }
 
 void streamfx::filter::upscaling::upscaling_instance::task_switch_provider(util::threadpool_data_t data)
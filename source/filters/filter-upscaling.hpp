@@ -48,11 +48,12 @@ namespace streamfx::filter::upscaling {
 		std::pair<uint32_t, uint32_t> _in_size;
 		std::pair<uint32_t, uint32_t> _out_size;
 
-		std::atomic<upscaling_provider>         _provider;
-		upscaling_provider                      _provider_ui;
-		std::atomic<bool>                       _provider_ready;
-		std::mutex                              _provider_lock;
-		std::shared_ptr<util::threadpool::task> _provider_task;
+		std::atomic<upscaling_provider>                       _provider;
+		upscaling_provider                                    _provider_ui;
+		std::atomic<bool>                                     _provider_ready;
+		std::mutex                                            _provider_lock;
+		std::shared_ptr<util::threadpool::task>               _provider_task;
+		std::shared_ptr<util::threadpool::cancellation_token> _provider_token;
 
 		std::shared_ptr<::streamfx::obs::gs::effect>  _standard_effect;
 		std::shared_ptr<::streamfx::obs::gs::sampler> _channel0_sampler;
@@ -397,7 +397,8 @@ void streamfx::filter::virtual_greenscreen::virtual_greenscreen_instance::switch
 
 	// Then spawn a new task to switch provider.
 	_provider_task = streamfx::threadpool()->push(
-		std::bind(&virtual_greenscreen_instance::task_switch_provider, this, std::placeholders::_1), spd);
+		std::bind(&virtual_greenscreen_instance::task_switch_provider, this, std::placeholders::_1), spd,
+		util::threadpool_priority::BACKGROUND);
 }
 
 void streamfx::filter::virtual_greenscreen::virtual_greenscreen_instance::task_switch_provider(
@@ -21,6 +21,7 @@
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
 #include "plugin.hpp"
+#include "util/util-profiler.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -248,6 +249,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::box_linear::r
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::box_linear::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Box Linear Blur");
 #endif
 
@@ -338,6 +342,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::box_linear_di
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::box_linear_directional::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp =
 		streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Box Linear Directional Blur");
 #endif
@@ -21,6 +21,7 @@
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
 #include "plugin.hpp"
+#include "util/util-profiler.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -258,6 +259,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::box::render()
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::box::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Box Blur");
 #endif
 
@@ -348,6 +352,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::box_direction
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::box_directional::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Box Directional Blur");
 #endif
 
@@ -423,6 +430,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::box_rotationa
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::box_rotational::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Box Rotational Blur");
 #endif
 
@@ -489,6 +499,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::box_zoom::ren
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::box_zoom::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Box Zoom Blur");
 #endif
 
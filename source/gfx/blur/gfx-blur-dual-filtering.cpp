@@ -19,7 +19,9 @@
 #include <algorithm>
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "plugin.hpp"
+#include "util/util-profiler.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -185,17 +187,14 @@ std::shared_ptr<::streamfx::gfx::blur::dual_filtering_data> streamfx::gfx::blur:
 streamfx::gfx::blur::dual_filtering::dual_filtering()
 	: _data(::streamfx::gfx::blur::dual_filtering_factory::get().data()), _size(0), _iterations(0)
 {
-	auto gctx = streamfx::obs::gs::context();
-	_rts.resize(ST_MAX_LEVELS + 1);
-	for (std::size_t n = 0; n <= ST_MAX_LEVELS; n++) {
-		gs_color_format cf = GS_RGBA;
+	auto            gctx = streamfx::obs::gs::context();
+	gs_color_format cf   = GS_RGBA;
 #if 0
-		cf = GS_RGBA16F;
+	cf = GS_RGBA16F;
 #elif 0
-		cf = GS_RGBA32F;
+	cf = GS_RGBA32F;
 #endif
-		_rts[n] = std::make_shared<streamfx::obs::gs::rendertarget>(cf, GS_ZS_NONE);
-	}
+	_rt = std::make_shared<streamfx::obs::gs::rendertarget>(cf, GS_ZS_NONE);
 }
 
 streamfx::gfx::blur::dual_filtering::~dual_filtering() {}
@@ -230,6 +229,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::dual_filtering::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Dual-Filtering Blur");
 #endif
 
@@ -255,6 +257,12 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 	uint32_t height     = _input_texture->get_height();
 	size_t   iterations = _iterations;
 
+	// Level 0 is the output, all others go back to the pool once done.
+	std::vector<std::shared_ptr<streamfx::obs::gs::rendertarget>> rts(iterations + 1);
+	rts[0] = _rt;
+
+	auto pool = streamfx::obs::gs::rendertarget_pool::instance();
+
 	// Downsample
 	for (std::size_t n = 1; n <= iterations; n++) {
 #ifdef ENABLE_PROFILING
@@ -264,7 +272,7 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 		// Select Texture
 		std::shared_ptr<streamfx::obs::gs::texture> tex;
 		if (n > 1) {
-			tex = _rts[n - 1]->get_texture();
+			tex = rts[n - 1]->get_texture();
 		} else { // Idx 0 is a simply considered as a straight copy of the original and not rendered to.
 			tex = _input_texture;
 		}
@@ -282,8 +290,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 		effect.get_parameter("pImageSize").set_float2(float_t(owidth), float_t(oheight));
 		effect.get_parameter("pImageTexel").set_float2(0.5f / owidth, 0.5f / oheight);
 
+		rts[n] = pool->acquire(owidth, oheight, _rt->get_color_format());
 		{
-			auto op = _rts[n]->render(owidth, oheight);
+			auto op = rts[n]->render(owidth, oheight);
 			gs_ortho(0., 1., 0., 1., 0., 1.);
 			while (gs_effect_loop(effect.get_object(), "Down")) {
 				streamfx::gs_draw_fullscreen_tri();
@@ -298,7 +307,7 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 #endif
 
 		// Select Texture
-		std::shared_ptr<streamfx::obs::gs::texture> tex = _rts[n]->get_texture();
+		std::shared_ptr<streamfx::obs::gs::texture> tex = rts[n]->get_texture();
 
 		// Get Size
 		uint32_t iwidth  = tex->get_width();
@@ -312,7 +321,7 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 		effect.get_parameter("pImageTexel").set_float2(0.5f / iwidth, 0.5f / iheight);
 
 		{
-			auto op = _rts[n - 1]->render(owidth, oheight);
+			auto op = rts[n - 1]->render(owidth, oheight);
 			gs_ortho(0., 1., 0., 1., 0., 1.);
 			while (gs_effect_loop(effect.get_object(), "Up")) {
 				streamfx::gs_draw_fullscreen_tri();
@@ -322,10 +331,10 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filterin
 
 	gs_blend_state_pop();
 
-	return _rts[0]->get_texture();
+	return _rt->get_texture();
 }
 
 std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::dual_filtering::get()
 {
-	return _rts[0]->get_texture();
+	return _rt->get_texture();
 }
@@ -88,7 +88,8 @@ namespace streamfx::gfx {
 
 			std::shared_ptr<streamfx::obs::gs::texture> _input_texture;
 
-			std::vector<std::shared_ptr<streamfx::obs::gs::rendertarget>> _rts;
+			// Only the output is kept, the smaller levels are taken from the render target pool while rendering.
+			std::shared_ptr<streamfx::obs::gs::rendertarget> _rt;
 
 			public:
 			dual_filtering();
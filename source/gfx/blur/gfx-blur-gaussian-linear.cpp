@@ -18,6 +18,7 @@
 #include "gfx-blur-gaussian-linear.hpp"
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
+#include "util/util-profiler.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -299,6 +300,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::gaussian_line
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::gaussian_linear::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Gaussian Linear Blur");
 #endif
 
@@ -404,6 +408,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::gaussian_line
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::gaussian_linear_directional::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance,
 												"Gaussian Linear Directional Blur");
 #endif
@@ -20,6 +20,7 @@
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
 #include "plugin.hpp"
+#include "util/util-profiler.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -326,6 +327,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::gaussian::ren
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::gaussian::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Gaussian Blur");
 #endif
 
@@ -431,6 +435,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::gaussian_dire
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::gaussian_directional::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp =
 		streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Gaussian Directional Blur");
 #endif
@@ -489,6 +496,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::gaussian_rota
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::gaussian_rotational::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp =
 		streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Gaussian Rotational Blur");
 #endif
@@ -571,6 +581,9 @@ std::shared_ptr<::streamfx::obs::gs::texture> streamfx::gfx::blur::gaussian_zoom
 	auto gctx = streamfx::obs::gs::context();
 
 #ifdef ENABLE_PROFILING
+	static auto profiler = ::streamfx::util::profiler_registry::get("gfx::blur::gaussian_zoom::render");
+	auto        profile  = profiler->track();
+
 	auto gdmp = streamfx::obs::gs::debug_marker(streamfx::obs::gs::debug_color_azure_radiance, "Gaussian Zoom Blur");
 #endif
 
@@ -24,7 +24,6 @@
 #include "gfx/gfx-debug.hpp"
 #include "obs/gs/gs-helper.hpp"
 #include "obs/obs-source-tracker.hpp"
-#include "util/util-platform.hpp"
 
 // TODO:
 // - FFT Audio Conversion
@@ -281,19 +280,23 @@ void streamfx::gfx::shader::texture_parameter::assign()
 	if (_dirty && ((_dirty_ts - std::chrono::high_resolution_clock::now()) < std::chrono::milliseconds(0))) {
 		// Reload or Reacquire everything necessary.
 		try {
-			// Remove now unused references.
+			bool from_file = ((field_type() == texture_field_type::Input) && (_type == texture_type::File))
+							 || (field_type() == texture_field_type::Enum);
+
+			// Remove now unused references. A file texture stays in use until its replacement is loaded.
 			_source.reset();
 			_source_child.reset();
 			_source_active.reset();
 			_source_visible.reset();
 			_source_rendertarget.reset();
-			_file_texture.reset();
+			_file_request.reset();
+			if (!from_file || _file_path.empty()) {
+				_file_texture.reset();
+			}
 
-			if (((field_type() == texture_field_type::Input) && (_type == texture_type::File))
-				|| (field_type() == texture_field_type::Enum)) {
+			if (from_file) {
 				if (!_file_path.empty()) {
-					_file_texture = std::make_shared<streamfx::obs::gs::texture>(
-						streamfx::util::platform::native_to_utf8(_file_path).generic_u8string().c_str());
+					_file_request = streamfx::obs::gs::texture_loader::instance()->load(_file_path);
 				}
 			} else if ((field_type() == texture_field_type::Input) && (_type == texture_type::Source)) {
 				// Try and grab the source itself.
@@ -334,6 +337,17 @@ void streamfx::gfx::shader::texture_parameter::assign()
 		}
 	}
 
+	// Files which failed to load are retried like any other failure above.
+	if (_file_request && _file_request->is_done()) {
+		try {
+			_file_texture = _file_request->get_texture();
+		} catch (...) {
+			_dirty    = true;
+			_dirty_ts = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds(5000);
+		}
+		_file_request.reset();
+	}
+
 	// If this is a source and active or visible, capture it.
 	if ((_type == texture_type::Source) && (_active || _visible) && _source_rendertarget) {
 		auto source = _source.lock();
@@ -6,6 +6,7 @@
 #include "gfx-shader-param.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
+#include "obs/gs/gs-texture-loader.hpp"
 #include "obs/obs-source-active-child.hpp"
 #include "obs/obs-source-active-reference.hpp"
 #include "obs/obs-source-showing-reference.hpp"
@@ -54,8 +55,9 @@ namespace streamfx::gfx {
 			std::chrono::high_resolution_clock::time_point _dirty_ts;
 
 			// Data: File
-			std::filesystem::path                       _file_path;
-			std::shared_ptr<streamfx::obs::gs::texture> _file_texture;
+			std::filesystem::path                                       _file_path;
+			std::shared_ptr<streamfx::obs::gs::texture>                 _file_texture;
+			std::shared_ptr<streamfx::obs::gs::texture_loader::request> _file_request;
 
 			// Data: Source
 			std::string                                              _source_name;
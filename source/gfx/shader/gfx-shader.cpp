@@ -113,6 +113,24 @@ try {
 		_shader_file_sz   = std::filesystem::file_size(file);
 		_shader_file      = file;
 		_shader_file_tick = 0;
+
+		using type = streamfx::obs::gs::effect_parameter::type;
+		auto find_texture = [this](std::initializer_list<std::string_view> names) {
+			for (auto& name : names) {
+				if (auto el = _shader.get_parameter(name, type::Texture); el != nullptr) {
+					return el;
+				}
+			}
+			return streamfx::obs::gs::effect_parameter();
+		};
+		_param_time            = _shader.get_parameter("Time", type::Float4);
+		_param_view_size       = _shader.get_parameter("ViewSize", type::Float4);
+		_param_random          = _shader.get_parameter("Random", type::Matrix);
+		_param_random_seed     = _shader.get_parameter("RandomSeed", type::Integer);
+		_param_input_a         = find_texture({"InputA", "image", "tex_a"});
+		_param_input_b         = find_texture({"InputB", "image2", "tex_b"});
+		_param_transition_time = _shader.get_parameter("TransitionTime", type::Float);
+		_param_transition_size = _shader.get_parameter("TransitionSize", type::Integer2);
 	}
 
 	// Update Params
@@ -462,34 +480,26 @@ void streamfx::gfx::shader::shader::prepare_render()
 	}
 
 	// float4 Time: (Time in Seconds), (Time in Current Second), (Time in Seconds only), (Random Value)
-	if (streamfx::obs::gs::effect_parameter el = _shader.get_parameter("Time"); el != nullptr) {
-		if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Float4) {
-			el.set_float4(
-				_time, _time_loop, static_cast<float_t>(_loops),
-				static_cast<float_t>(static_cast<double_t>(_random()) / static_cast<double_t>(_random.max())));
-		}
+	if (_param_time) {
+		_param_time.set_float4(
+			_time, _time_loop, static_cast<float_t>(_loops),
+			static_cast<float_t>(static_cast<double_t>(_random()) / static_cast<double_t>(_random.max())));
 	}
 
 	// float4 ViewSize: (Width), (Height), (1.0 / Width), (1.0 / Height)
-	if (auto el = _shader.get_parameter("ViewSize"); el != nullptr) {
-		if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Float4) {
-			el.set_float4(static_cast<float_t>(width()), static_cast<float_t>(height()),
-						  1.0f / static_cast<float_t>(width()), 1.0f / static_cast<float_t>(height()));
-		}
+	if (_param_view_size) {
+		_param_view_size.set_float4(static_cast<float_t>(width()), static_cast<float_t>(height()),
+									1.0f / static_cast<float_t>(width()), 1.0f / static_cast<float_t>(height()));
 	}
 
 	// float4x4 Random: float4[Per-Instance Random], float4[Per-Activation Random], float4x2[Per-Frame Random]
-	if (auto el = _shader.get_parameter("Random"); el != nullptr) {
-		if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Matrix) {
-			el.set_value(_random_values, 16);
-		}
+	if (_param_random) {
+		_param_random.set_value(_random_values, 16);
 	}
 
 	// int32 RandomSeed: Seed used for random generation
-	if (auto el = _shader.get_parameter("RandomSeed"); el != nullptr) {
-		if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Integer) {
-			el.set_int(_random_seed);
-		}
+	if (_param_random_seed) {
+		_param_random_seed.set_int(_random_seed);
 	}
 
 	return;
@@ -562,18 +572,8 @@ void streamfx::gfx::shader::shader::set_input_a(std::shared_ptr<streamfx::obs::g
 	if (!_shader)
 		return;
 
-	std::string_view params[] = {
-		"InputA",
-		"image",
-		"tex_a",
-	};
-	for (auto& name : params) {
-		if (streamfx::obs::gs::effect_parameter el = _shader.get_parameter(name.data()); el != nullptr) {
-			if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Texture) {
-				el.set_texture(tex, srgb);
-				break;
-			}
-		}
+	if (_param_input_a) {
+		_param_input_a.set_texture(tex, srgb);
 	}
 }
 
@@ -582,18 +582,8 @@ void streamfx::gfx::shader::shader::set_input_b(std::shared_ptr<streamfx::obs::g
 	if (!_shader)
 		return;
 
-	std::string_view params[] = {
-		"InputB",
-		"image2",
-		"tex_b",
-	};
-	for (auto& name : params) {
-		if (streamfx::obs::gs::effect_parameter el = _shader.get_parameter(name.data()); el != nullptr) {
-			if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Texture) {
-				el.set_texture(tex, srgb);
-				break;
-			}
-		}
+	if (_param_input_b) {
+		_param_input_b.set_texture(tex, srgb);
 	}
 }
 
@@ -602,10 +592,8 @@ void streamfx::gfx::shader::shader::set_transition_time(float_t t)
 	if (!_shader)
 		return;
 
-	if (streamfx::obs::gs::effect_parameter el = _shader.get_parameter("TransitionTime"); el != nullptr) {
-		if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Float) {
-			el.set_float(t);
-		}
+	if (_param_transition_time) {
+		_param_transition_time.set_float(t);
 	}
 }
 
@@ -613,10 +601,8 @@ void streamfx::gfx::shader::shader::set_transition_size(uint32_t w, uint32_t h)
 {
 	if (!_shader)
 		return;
-	if (streamfx::obs::gs::effect_parameter el = _shader.get_parameter("TransitionSize"); el != nullptr) {
-		if (el.get_type() == streamfx::obs::gs::effect_parameter::type::Integer2) {
-			el.set_int2(static_cast<int32_t>(w), static_cast<int32_t>(h));
-		}
+	if (_param_transition_size) {
+		_param_transition_size.set_int2(static_cast<int32_t>(w), static_cast<int32_t>(h));
 	}
 }
 
@@ -59,6 +59,16 @@ namespace streamfx::gfx {
 			float_t                         _shader_file_tick;
 			shader_param_map_t              _shader_params;
 
+			// Parameters provided by StreamFX, looked up once per load instead of every frame.
+			streamfx::obs::gs::effect_parameter _param_time;
+			streamfx::obs::gs::effect_parameter _param_view_size;
+			streamfx::obs::gs::effect_parameter _param_random;
+			streamfx::obs::gs::effect_parameter _param_random_seed;
+			streamfx::obs::gs::effect_parameter _param_input_a;
+			streamfx::obs::gs::effect_parameter _param_input_b;
+			streamfx::obs::gs::effect_parameter _param_transition_time;
+			streamfx::obs::gs::effect_parameter _param_transition_size;
+
 			// Options
 			size_type _width_type;
 			double_t  _width_value;
@@ -0,0 +1,118 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2017 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gs-effect-cache.hpp"
+#include "util/util-logging.hpp"
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<gs::effect_cache> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+static std::tuple<std::string, std::size_t, std::size_t> make_key(std::string_view file, std::string_view code)
+{
+	return std::make_tuple(std::string(file), std::hash<std::string_view>{}(code), code.size());
+}
+
+streamfx::obs::gs::effect_cache::~effect_cache()
+{
+	D_LOG_INFO("%" PRIu64 " effects were shared and %" PRIu64 " compiled.", _hits, _misses);
+}
+
+streamfx::obs::gs::effect_cache::effect_cache() : _lock(), _effects(), _hits(0), _misses(0) {}
+
+std::shared_ptr<gs_effect_t> streamfx::obs::gs::effect_cache::find(std::string_view file, std::string_view code)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	if (auto kv = _effects.find(make_key(file, code)); kv != _effects.end()) {
+		if (auto effect = kv->second.lock(); effect) {
+			_hits++;
+			D_LOG_DEBUG("Sharing already compiled effect '%.*s'.", static_cast<int>(file.size()), file.data());
+			return effect;
+		}
+	}
+	return nullptr;
+}
+
+std::shared_ptr<gs_effect_t> streamfx::obs::gs::effect_cache::insert(std::string_view file, std::string_view code,
+																	   std::shared_ptr<gs_effect_t> effect)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+
+	// Forget about effects nobody uses anymore.
+	for (auto kv = _effects.begin(); kv != _effects.end();) {
+		if (kv->second.expired()) {
+			kv = _effects.erase(kv);
+		} else {
+			kv++;
+		}
+	}
+
+	auto key = make_key(file, code);
+	if (auto kv = _effects.find(key); kv != _effects.end()) {
+		if (auto existing = kv->second.lock(); existing) {
+			_hits++;
+			return existing;
+		}
+	}
+
+	_misses++;
+	_effects.insert_or_assign(key, effect);
+	return effect;
+}
+
+streamfx::obs::gs::effect_cache::statistics streamfx::obs::gs::effect_cache::get_statistics()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+
+	std::size_t effects = 0;
+	for (auto& kv : _effects) {
+		if (!kv.second.expired()) {
+			effects++;
+		}
+	}
+	return {_hits, _misses, effects};
+}
+
+static std::shared_ptr<streamfx::obs::gs::effect_cache> _cache;
+
+void streamfx::obs::gs::effect_cache::initialize()
+{
+	if (!_cache)
+		_cache = std::make_shared<streamfx::obs::gs::effect_cache>();
+}
+
+void streamfx::obs::gs::effect_cache::finalize()
+{
+	_cache.reset();
+}
+
+std::shared_ptr<streamfx::obs::gs::effect_cache> streamfx::obs::gs::effect_cache::instance()
+{
+	return _cache;
+}
@@ -0,0 +1,72 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2017 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace streamfx::obs::gs {
+	/** Compiled effects shared by everything in the plugin.
+	 *
+	 * Effects are keyed by their canonical path and the preprocessed code, which covers every included file and every
+	 * define, so an effect is only compiled again if something that changes the result has changed. The cache does not
+	 * own any of the effects, an effect is destroyed as soon as the last user lets go of it.
+	 */
+	class effect_cache {
+		typedef std::tuple<std::string, std::size_t, std::size_t> key_t; // Path, code hash and code length.
+
+		std::mutex                                  _lock;
+		std::map<key_t, std::weak_ptr<gs_effect_t>> _effects;
+
+		uint64_t _hits;
+		uint64_t _misses;
+
+		public:
+		struct statistics {
+			uint64_t    hits;    // Shared with an existing user.
+			uint64_t    misses;  // Had to be compiled.
+			std::size_t effects; // Currently alive.
+		};
+
+		~effect_cache();
+		effect_cache();
+
+		/** Retrieve an already compiled effect for the file and code, or nullptr if there is none. */
+		std::shared_ptr<gs_effect_t> find(std::string_view file, std::string_view code);
+
+		/** Offer a freshly compiled effect, and return the one everyone should use.
+		 *
+		 * If another thread compiled the same effect in the meantime, that one is returned instead.
+		 */
+		std::shared_ptr<gs_effect_t> insert(std::string_view file, std::string_view code,
+											std::shared_ptr<gs_effect_t> effect);
+
+		statistics get_statistics();
+
+		public /* Singleton */:
+		static void                                                initialize();
+		static void                                                finalize();
+		static std::shared_ptr<::streamfx::obs::gs::effect_cache> instance();
+	};
+} // namespace streamfx::obs::gs
@@ -18,79 +18,170 @@
  */
 
 #include "gs-effect.hpp"
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_map>
 #include <vector>
+#include "obs/gs/gs-effect-cache.hpp"
 #include "obs/gs/gs-helper.hpp"
 #include "util/util-platform.hpp"
 
 #define MAX_EFFECT_SIZE 32 * 1024 * 1024 // 32 MiB, big enough for everything.
 
-static std::string load_file_as_code(const std::filesystem::path& shader_file, bool is_top_level = true)
+namespace {
+	struct file_stamp {
+		std::filesystem::path           path;
+		std::filesystem::file_time_type time;
+		uintmax_t                       size;
+	};
+
+	struct preprocessed_file {
+		std::vector<file_stamp> files; // The file itself, followed by everything it includes.
+		std::string             code;
+	};
+
+	// Files like 'shared.effect' are included by nearly every effect, so they are only read again once they change.
+	std::mutex                                         preprocessed_lock;
+	std::map<std::filesystem::path, preprocessed_file> preprocessed_files;
+
+	// Destroys the effect, and holds the index of its parameters by name.
+	//
+	// Living in the control block ties the index to the effect itself, so every copy of the pointer shares it, and
+	// reset() or assignment can never leave it behind pointing at names of a destroyed effect.
+	struct effect_deleter {
+		std::unordered_map<std::string_view, std::size_t> parameters;
+
+		void operator()(gs_effect_t* ptr)
+		{
+			gs_effect_destroy(ptr);
+		}
+	};
+} // namespace
+
+static file_stamp make_stamp(const std::filesystem::path& path)
+{
+	return {path, std::filesystem::last_write_time(path), std::filesystem::file_size(path)};
+}
+
+static bool is_unchanged(const file_stamp& stamp)
+{
+	std::error_code ec;
+	if (std::filesystem::last_write_time(stamp.path, ec) != stamp.time || ec) {
+		return false;
+	}
+	if (std::filesystem::file_size(stamp.path, ec) != stamp.size || ec) {
+		return false;
+	}
+	return true;
+}
+
+static const preprocessed_file& preprocess_file(const std::filesystem::path& shader_file)
 {
-	std::stringstream           shader_stream;
-	const std::filesystem::path shader_path = std::filesystem::absolute(shader_file.native());
+	const std::filesystem::path shader_path =
+		std::filesystem::weakly_canonical(std::filesystem::absolute(shader_file.native()));
 	const std::filesystem::path shader_root = std::filesystem::path(shader_path.native()).remove_filename();
 
+	// Reuse the previous result if neither the file nor anything it includes has changed.
+	if (auto kv = preprocessed_files.find(shader_path); kv != preprocessed_files.end()) {
+		if (std::all_of(kv->second.files.begin(), kv->second.files.end(), is_unchanged)) {
+			return kv->second;
+		}
+	}
+
+	preprocessed_file result;
+	result.files.push_back(make_stamp(shader_path));
+
 	// Ensure it meets size limits.
-	uintmax_t size = std::filesystem::file_size(shader_path);
+	uintmax_t size = result.files.front().size;
 	if (size > MAX_EFFECT_SIZE) {
 		throw std::runtime_error("File is too large to be loaded.");
 	}
 
-	// Try to open as-is.
-	std::ifstream ifs(shader_path, std::ios::in);
-	if (!ifs.is_open() || ifs.bad()) {
-		throw std::runtime_error("Failed to open file.");
-	}
-
-	// Push Graphics API to shader.
-	if (is_top_level) {
-		auto gctx = streamfx::obs::gs::context();
-		switch (gs_get_device_type()) {
-		case GS_DEVICE_DIRECT3D_11:
-			shader_stream << "#define GS_DEVICE_DIRECT3D_11" << std::endl;
-			shader_stream << "#define GS_DEVICE_DIRECT3D" << std::endl;
-			break;
-		case GS_DEVICE_OPENGL:
-			shader_stream << "#define GS_DEVICE_OPENGL" << std::endl;
-			break;
+	// Read the whole file at once, instead of line by line.
+	std::string content;
+	{
+		std::ifstream ifs(shader_path, std::ios::in | std::ios::binary);
+		if (!ifs.is_open() || ifs.bad()) {
+			throw std::runtime_error("Failed to open file.");
 		}
+		content.resize(static_cast<std::size_t>(size));
+		ifs.read(content.data(), static_cast<std::streamsize>(size));
+		content.resize(static_cast<std::size_t>(ifs.gcount()));
 	}
 
 	// Pre-process the shader.
-	std::string line;
-	while (std::getline(ifs, line)) {
-		std::string line_trimmed = line;
-
-		{ // Figure out the length of the trim.
-			size_t trim_length = 0;
-			for (size_t idx = 0, edx = line_trimmed.length(); idx < edx; idx++) {
-				char ch = line_trimmed.at(idx);
-				if ((ch != ' ') && (ch != '\t')) {
-					trim_length = idx;
-					break;
-				}
-			}
-			if (trim_length > 0) {
-				line_trimmed.erase(0, trim_length);
-			}
+	std::stringstream shader_stream;
+	for (std::size_t pos = 0, edx = content.size(); pos < edx;) {
+		std::size_t eol = content.find('\n', pos);
+		if (eol == std::string::npos) {
+			eol = edx;
+		}
+		std::string_view line(content.data() + pos, eol - pos);
+		pos = eol + 1;
+
+		if (!line.empty() && (line.back() == '\r')) {
+			line.remove_suffix(1);
+		}
+
+		std::string_view line_trimmed = line;
+		if (auto trim_length = line_trimmed.find_first_not_of(" \t");
+			(trim_length != std::string_view::npos) && (trim_length > 0)) {
+			line_trimmed.remove_prefix(trim_length);
 		}
 
 		// Handle '#include'
 		if (line_trimmed.substr(0, 8) == "#include") {
-			std::string           include_str  = line_trimmed.substr(10, line_trimmed.size() - 11); // '#include "'
+			std::string           include_str(line_trimmed.substr(10, line_trimmed.size() - 11)); // '#include "'
 			std::filesystem::path include_path = include_str;
 
 			if (!include_path.is_absolute()) {
 				include_path = shader_root / include_str;
 			}
 
-			line = load_file_as_code(include_path, false);
+			const preprocessed_file& included = preprocess_file(include_path);
+			for (auto& stamp : included.files) {
+				if (std::find_if(result.files.begin(), result.files.end(),
+								 [&stamp](file_stamp& value) { return value.path == stamp.path; })
+					== result.files.end()) {
+					result.files.push_back(stamp);
+				}
+			}
+			shader_stream << included.code << "\n";
+			continue;
+		}
+
+		shader_stream << line << "\n";
+	}
+	result.code = shader_stream.str();
+
+	return preprocessed_files.insert_or_assign(shader_path, std::move(result)).first->second;
+}
+
+static std::string load_file_as_code(const std::filesystem::path& shader_file)
+{
+	std::stringstream shader_stream;
+
+	// Push Graphics API to shader.
+	{
+		auto gctx = streamfx::obs::gs::context();
+		switch (gs_get_device_type()) {
+		case GS_DEVICE_DIRECT3D_11:
+			shader_stream << "#define GS_DEVICE_DIRECT3D_11" << std::endl;
+			shader_stream << "#define GS_DEVICE_DIRECT3D" << std::endl;
+			break;
+		case GS_DEVICE_OPENGL:
+			shader_stream << "#define GS_DEVICE_OPENGL" << std::endl;
+			break;
 		}
+	}
 
-		shader_stream << line << std::endl;
+	{
+		std::unique_lock<std::mutex> lock(preprocessed_lock);
+		shader_stream << preprocess_file(shader_file).code;
 	}
 
 	return shader_stream.str();
@@ -108,13 +199,37 @@ streamfx::obs::gs::effect::effect(std::string_view code, std::string_view name)
 						   : std::runtime_error("Unknown error during effect compile.");
 	}
 
-	reset(effect, [](gs_effect_t* ptr) { gs_effect_destroy(ptr); });
+	effect_deleter deleter;
+	deleter.parameters.reserve(static_cast<std::size_t>(effect->params.num));
+	for (std::size_t idx = 0; idx < effect->params.num; idx++) {
+		deleter.parameters.emplace(effect->params.array[idx].name, idx);
+	}
+	reset(effect, std::move(deleter));
 }
 
 streamfx::obs::gs::effect::effect(std::filesystem::path file)
-	: effect(load_file_as_code(file),
-			 streamfx::util::platform::utf8_to_native(std::filesystem::absolute(file)).generic_u8string())
-{}
+{
+	std::string code = load_file_as_code(file);
+	std::string name = streamfx::util::platform::utf8_to_native(std::filesystem::absolute(file)).generic_u8string();
+	std::string key  = std::filesystem::weakly_canonical(std::filesystem::absolute(file)).generic_u8string();
+
+	// Identical effects are only compiled once, and then shared by everyone who loads them.
+	auto cache = streamfx::obs::gs::effect_cache::instance();
+	if (cache) {
+		if (auto found = cache->find(key, code); found) {
+			std::shared_ptr<gs_effect_t>::operator=(found);
+			return;
+		}
+	}
+
+	// Compiling outside of the cache, as that needs the graphics context.
+	streamfx::obs::gs::effect compiled(code, name);
+	if (cache) {
+		std::shared_ptr<gs_effect_t>::operator=(cache->insert(key, code, compiled));
+	} else {
+		*this = compiled;
+	}
+}
 
 streamfx::obs::gs::effect::~effect()
 {
@@ -171,6 +286,13 @@ streamfx::obs::gs::effect_parameter streamfx::obs::gs::effect::get_parameter(std
 
 streamfx::obs::gs::effect_parameter streamfx::obs::gs::effect::get_parameter(std::string_view name)
 {
+	if (auto deleter = std::get_deleter<effect_deleter>(*this); deleter) {
+		if (auto kv = deleter->parameters.find(name); kv != deleter->parameters.end()) {
+			return streamfx::obs::gs::effect_parameter(get()->params.array + kv->second, *this);
+		}
+		return nullptr;
+	}
+
 	for (std::size_t idx = 0; idx < count_parameters(); idx++) {
 		auto ptr = get()->params.array + idx;
 		if (strcmp(ptr->name, name.data()) == 0) {
@@ -195,3 +317,12 @@ bool streamfx::obs::gs::effect::has_parameter(std::string_view name, effect_para
 		return eprm.get_type() == type;
 	return false;
 }
+
+streamfx::obs::gs::effect_parameter streamfx::obs::gs::effect::get_parameter(std::string_view name,
+																			 effect_parameter::type type)
+{
+	if (auto eprm = get_parameter(name); eprm && (eprm.get_type() == type)) {
+		return eprm;
+	}
+	return nullptr;
+}
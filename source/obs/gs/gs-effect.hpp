@@ -43,6 +43,13 @@ namespace streamfx::obs::gs {
 		bool                                has_parameter(std::string_view name);
 		bool                                has_parameter(std::string_view name, effect_parameter::type type);
 
+		/** Retrieve a parameter only if it is of the given type, or nullptr otherwise.
+		 *
+		 * The result stays valid for as long as this effect exists, so anything that sets the same parameter every
+		 * frame should look it up once and keep it.
+		 */
+		streamfx::obs::gs::effect_parameter get_parameter(std::string_view name, effect_parameter::type type);
+
 		public /* Legacy Support */:
 		inline gs_effect_t* get_object()
 		{
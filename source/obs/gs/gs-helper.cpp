@@ -18,3 +18,238 @@
  */
 
 #include "gs-helper.hpp"
+#include "configuration.hpp"
+#include "util/util-logging.hpp"
+
+#ifdef ENABLE_PROFILING
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<gs::debug_timing> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+// Configuration
+#define ST_CFG_GPU "profiler.gpu"
+
+// Number of frames to wait before reading back queries, so that the GPU has certainly finished them.
+#define ST_TIMING_LATENCY 3
+
+// Outermost scopes waiting for read back, older ones are dropped if the GPU falls this far behind.
+#define ST_TIMING_PENDING_LIMIT 256
+
+static uint32_t current_frame()
+{
+	if (video_t* video = obs_get_video(); video) {
+		return video_output_get_total_frames(video);
+	}
+	return 0;
+}
+
+streamfx::obs::gs::debug_timing::~debug_timing()
+{
+	auto gctx = streamfx::obs::gs::context();
+
+	// Anything still queued is incomplete, so there is nothing left worth reading.
+	if (_current) {
+		_pending.push_back(std::move(_current));
+	}
+	while (!_pending.empty()) {
+		recycle(std::move(_pending.front()));
+		_pending.pop_front();
+	}
+
+	for (auto timer : _free_timers) {
+		gs_timer_destroy(timer);
+	}
+	for (auto range : _free_ranges) {
+		gs_timer_range_destroy(range);
+	}
+}
+
+streamfx::obs::gs::debug_timing::debug_timing()
+	: _current(), _stack(), _stack_names(), _name(), _pending(), _free_timers(), _free_ranges(), _profilers()
+{}
+
+void streamfx::obs::gs::debug_timing::begin(std::string_view name)
+{
+	if (!_current) {
+		// Nothing else is in flight at the start of an outermost scope, which makes this a good place to read back.
+		collect();
+
+		_current = std::make_unique<batch>();
+		if (!_free_ranges.empty()) {
+			_current->range = _free_ranges.back();
+			_free_ranges.pop_back();
+		} else {
+			_current->range = gs_timer_range_create();
+		}
+		_current->frame = current_frame();
+		if (_current->range) {
+			gs_timer_range_begin(_current->range);
+		}
+
+		_name = "gpu::";
+	}
+
+	_stack_names.push_back(_name.size());
+	if (!_stack.empty()) {
+		_name.push_back('/');
+	}
+	_name.append(name);
+
+	scope entry;
+	if (!_free_timers.empty()) {
+		entry.timer = _free_timers.back();
+		_free_timers.pop_back();
+	} else {
+		entry.timer = gs_timer_create();
+	}
+	if (auto kv = _profilers.find(_name); kv != _profilers.end()) {
+		entry.profiler   = kv->second.first;
+		entry.trace_name = kv->second.second;
+	} else {
+		entry.profiler   = ::streamfx::util::profiler_registry::get(_name);
+		entry.trace_name = ::streamfx::util::tracer::intern(name);
+		_profilers.emplace(_name, std::make_pair(entry.profiler, entry.trace_name));
+	}
+	entry.depth     = _stack.size();
+	entry.submitted = std::chrono::steady_clock::now();
+
+	if (entry.timer) {
+		gs_timer_begin(entry.timer);
+	}
+	_stack.push_back(_current->scopes.size());
+	_current->scopes.push_back(std::move(entry));
+}
+
+void streamfx::obs::gs::debug_timing::end()
+{
+	if (_stack.empty()) {
+		return;
+	}
+
+	if (auto timer = _current->scopes[_stack.back()].timer; timer) {
+		gs_timer_end(timer);
+	}
+	_stack.pop_back();
+	_name.resize(_stack_names.back());
+	_stack_names.pop_back();
+
+	if (_stack.empty()) {
+		if (_current->range) {
+			gs_timer_range_end(_current->range);
+		}
+		_pending.push_back(std::move(_current));
+
+		if (_pending.size() > ST_TIMING_PENDING_LIMIT) {
+			recycle(std::move(_pending.front()));
+			_pending.pop_front();
+		}
+	}
+}
+
+void streamfx::obs::gs::debug_timing::collect()
+{
+	uint32_t frame = current_frame();
+
+	while (!_pending.empty()) {
+		auto& entry = _pending.front();
+		if ((frame - entry->frame) < ST_TIMING_LATENCY) {
+			break;
+		}
+
+		bool     disjoint  = true;
+		uint64_t frequency = 0;
+		if (entry->range && !gs_timer_range_get_data(entry->range, &disjoint, &frequency)) {
+			// Still in flight, and so is everything after it.
+			break;
+		}
+
+		// Disjoint ranges had their clock change in between, so their timestamps can't be compared.
+		if (!disjoint && (frequency > 0)) {
+			auto tracer = ::streamfx::util::tracer::instance();
+
+			// Only durations are known, so nested scopes are laid out back to back from the start of their parent,
+			// and the outermost scope starts when it was submitted.
+			std::vector<std::chrono::steady_clock::time_point> cursors;
+
+			for (auto& scope : entry->scopes) {
+				uint64_t ticks = 0;
+				if (!scope.timer || !gs_timer_get_data(scope.timer, &ticks)) {
+					ticks = 0;
+				}
+				auto duration = std::chrono::nanoseconds(
+					static_cast<int64_t>(static_cast<double_t>(ticks) * 1000000000. / frequency));
+				if (ticks > 0) {
+					scope.profiler->track(duration);
+				}
+
+				if (tracer) {
+					cursors.resize(scope.depth);
+					auto start = cursors.empty() ? scope.submitted : cursors.back();
+					if (!cursors.empty()) {
+						cursors.back() += duration;
+					}
+					cursors.push_back(start);
+
+					if (ticks > 0) {
+						tracer->record("GPU", scope.trace_name, ::streamfx::util::trace_category::GPU, start, duration);
+					}
+				}
+			}
+		}
+
+		recycle(std::move(entry));
+		_pending.pop_front();
+	}
+}
+
+void streamfx::obs::gs::debug_timing::recycle(std::unique_ptr<batch> entry)
+{
+	for (auto& scope : entry->scopes) {
+		if (scope.timer) {
+			_free_timers.push_back(scope.timer);
+		}
+	}
+	if (entry->range) {
+		_free_ranges.push_back(entry->range);
+	}
+}
+
+static std::shared_ptr<streamfx::obs::gs::debug_timing> _timing;
+
+void streamfx::obs::gs::debug_timing::initialize()
+{
+	if (_timing)
+		return;
+
+	// Timestamp queries aren't free, so this has to be requested explicitly.
+	if (auto config = streamfx::configuration::instance(); config) {
+		auto dataptr = config->get();
+		if (obs_data_get_bool(dataptr.get(), ST_CFG_GPU)) {
+			_timing = std::make_shared<streamfx::obs::gs::debug_timing>();
+			D_LOG_INFO("GPU timing of debug markers is enabled.", "");
+		}
+	}
+}
+
+void streamfx::obs::gs::debug_timing::finalize()
+{
+	_timing.reset();
+}
+
+std::shared_ptr<streamfx::obs::gs::debug_timing> streamfx::obs::gs::debug_timing::instance()
+{
+	return _timing;
+}
+
+#endif
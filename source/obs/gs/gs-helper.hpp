@@ -19,14 +19,24 @@
 
 #pragma once
 #include "common.hpp"
+#include <deque>
 #include <vector>
 #include "plugin.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "util/util-trace.hpp"
+#endif
+
 namespace streamfx::obs::gs {
 	class context {
 		public:
 		inline context()
 		{
+#ifdef ENABLE_PROFILING
+			// Time spent waiting for other threads to release the graphics context.
+			static const uint32_t           trace_name = ::streamfx::util::tracer::intern("gs::context");
+			::streamfx::util::tracer::scope trace(trace_name, ::streamfx::util::trace_category::WAIT);
+#endif
 			obs_enter_graphics();
 			if (gs_get_context() == nullptr)
 				throw std::runtime_error("Failed to enter graphics context.");
@@ -63,26 +73,105 @@ namespace streamfx::obs::gs {
 	static const float_t* debug_color_allocate     = debug_color_red;
 	static const float_t* debug_color_render       = debug_color_teal;
 
+	/** GPU timing of debug_marker scopes.
+	 *
+	 * Each scope is bracketed by a pair of GPU timestamp queries, which are read back a few frames later once the GPU
+	 * is guaranteed to have caught up, so that the render thread never stalls on them. The results are recorded into
+	 * the profiler registry as "gpu::<outer scope>/<inner scope>/...", and into the "GPU" track of the tracer. Scopes
+	 * are named by the format string of their debug_marker. Must only be used inside the graphics context.
+	 */
+	class debug_timing {
+		struct scope {
+			gs_timer_t*                                 timer;
+			std::shared_ptr<::streamfx::util::profiler> profiler;
+			uint32_t                                    trace_name;
+			std::size_t                                 depth;
+			std::chrono::steady_clock::time_point       submitted;
+		};
+
+		// All scopes recorded inside of one outermost scope, which share a timestamp frequency.
+		struct batch {
+			gs_timer_range_t*  range;
+			uint32_t           frame;
+			std::vector<scope> scopes;
+		};
+
+		std::unique_ptr<batch>             _current;
+		std::vector<std::size_t>           _stack;
+		std::vector<std::size_t>           _stack_names;
+		std::string                        _name;
+		std::deque<std::unique_ptr<batch>> _pending;
+
+		std::vector<gs_timer_t*>       _free_timers;
+		std::vector<gs_timer_range_t*> _free_ranges;
+
+		std::map<std::string, std::pair<std::shared_ptr<::streamfx::util::profiler>, uint32_t>, std::less<>>
+			_profilers;
+
+		public:
+		~debug_timing();
+		debug_timing();
+
+		void begin(std::string_view name);
+
+		void end();
+
+		private:
+		void collect();
+
+		void recycle(std::unique_ptr<batch> entry);
+
+		public /* Singleton */:
+		static void                                                initialize();
+		static void                                                finalize();
+		static std::shared_ptr<::streamfx::obs::gs::debug_timing> instance();
+	};
+
 	class debug_marker {
-		std::string _name;
+		const char*                                        _format;
+		std::shared_ptr<::streamfx::obs::gs::debug_timing> _timing;
+		::streamfx::util::tracer*                          _tracer;
+		std::chrono::steady_clock::time_point              _start;
 
 		public:
-		inline debug_marker(const float_t color[4], const char* format, ...)
+		inline debug_marker(const float_t color[4], const char* format, ...) : _format(format)
 		{
-			std::size_t       size;
 			std::vector<char> buffer(64);
 
 			va_list vargs;
 			va_start(vargs, format);
-			size = static_cast<size_t>(vsnprintf(buffer.data(), buffer.size(), format, vargs));
+			int size = vsnprintf(buffer.data(), buffer.size(), format, vargs);
 			va_end(vargs);
+			if (size < 0) {
+				size = 0;
+			} else if (static_cast<std::size_t>(size) >= buffer.size()) {
+				buffer.resize(static_cast<std::size_t>(size) + 1);
+				va_start(vargs, format);
+				vsnprintf(buffer.data(), buffer.size(), format, vargs);
+				va_end(vargs);
+			}
+
+			buffer[static_cast<std::size_t>(size)] = '\0';
+			gs_debug_marker_begin(color, buffer.data());
 
-			_name = std::string(buffer.data(), buffer.data() + size);
-			gs_debug_marker_begin(color, _name.c_str());
+			// Timing and tracing go by the format, as names are kept forever and formatted ones never stop changing.
+			if (_timing = debug_timing::instance(); _timing) {
+				_timing->begin(_format);
+			}
+			if (_tracer = ::streamfx::util::tracer::current(); _tracer) {
+				_start = std::chrono::steady_clock::now();
+			}
 		}
 
 		inline ~debug_marker()
 		{
+			if (_tracer) {
+				_tracer->record(::streamfx::util::tracer::intern(_format), ::streamfx::util::trace_category::MARKER,
+								_start, std::chrono::steady_clock::now() - _start);
+			}
+			if (_timing) {
+				_timing->end();
+			}
 			gs_debug_marker_end();
 		}
 	};
@@ -0,0 +1,259 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2017 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gs-rendertarget-pool.hpp"
+#include "obs/gs/gs-helper.hpp"
+#include "util/util-logging.hpp"
+
+#ifdef ENABLE_PROFILING
+#include "util/util-profiler.hpp"
+#endif
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<gs::rendertarget_pool> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+// Frames a render target may wait in the pool before it is destroyed. Sources which are only shown every now and then
+// keep their targets this way, without holding on to them forever.
+#define ST_POOL_IDLE_FRAMES 300
+
+// Estimated video memory that waiting render targets may occupy, beyond which the least recently used are destroyed.
+#define ST_POOL_FREE_LIMIT (256ull << 20)
+
+static uint32_t current_frame()
+{
+	if (video_t* video = obs_get_video(); video) {
+		return video_output_get_total_frames(video);
+	}
+	return 0;
+}
+
+static std::size_t estimate_size(uint32_t width, uint32_t height, gs_color_format color_format,
+								 gs_zstencil_format zstencil_format)
+{
+	std::size_t bits = gs_get_format_bpp(color_format);
+	switch (zstencil_format) {
+	case GS_Z16:
+		bits += 16;
+		break;
+	case GS_Z24_S8:
+	case GS_Z32F:
+		bits += 32;
+		break;
+	case GS_Z32F_S8X24:
+		bits += 64;
+		break;
+	default:
+		break;
+	}
+	return (static_cast<std::size_t>(width) * height * bits) / 8;
+}
+
+streamfx::obs::gs::rendertarget_pool::~rendertarget_pool()
+{
+	obs_remove_tick_callback(tick_callback, this);
+
+	D_LOG_INFO("%" PRIu64 " render targets were reused and %" PRIu64 " created, using up to %.1f MiB at once.", _hits,
+			   _misses, double_t(_bytes_peak) / double_t(1 << 20));
+}
+
+streamfx::obs::gs::rendertarget_pool::rendertarget_pool()
+	: _lock(), _free(), _frame(0), _hits(0), _misses(0), _targets(0), _targets_free(0), _bytes(0), _bytes_free(0),
+	  _bytes_peak(0)
+{
+	obs_add_tick_callback(tick_callback, this);
+}
+
+std::shared_ptr<streamfx::obs::gs::rendertarget>
+	streamfx::obs::gs::rendertarget_pool::acquire(uint32_t width, uint32_t height, gs_color_format color_format,
+												  gs_zstencil_format zstencil_format)
+{
+	key_t       key   = std::make_tuple(width, height, color_format, zstencil_format);
+	std::size_t bytes = estimate_size(width, height, color_format, zstencil_format);
+
+	// Destroyed outside of the lock, as that needs the graphics context.
+	std::vector<entry>                               expired;
+	std::unique_ptr<streamfx::obs::gs::rendertarget> target;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		if (uint32_t frame = current_frame(); frame != _frame) {
+			trim(frame, expired);
+		}
+
+		if (auto kv = _free.find(key); (kv != _free.end()) && !kv->second.empty()) {
+			target = std::move(kv->second.back().target);
+			kv->second.pop_back();
+			_targets_free--;
+			_bytes_free -= bytes;
+			_hits++;
+		} else {
+			_misses++;
+		}
+	}
+	expired.clear();
+
+	if (!target) {
+		target = std::make_unique<streamfx::obs::gs::rendertarget>(color_format, zstencil_format);
+
+		std::unique_lock<std::mutex> lock(_lock);
+		_targets++;
+		_bytes += bytes;
+		_bytes_peak = std::max(_bytes_peak, _bytes);
+	}
+
+	// Returned to whichever pool exists once released, or destroyed if there is none.
+	return std::shared_ptr<streamfx::obs::gs::rendertarget>(
+		target.release(), [key, bytes](streamfx::obs::gs::rendertarget* ptr) {
+			if (auto pool = streamfx::obs::gs::rendertarget_pool::instance(); pool) {
+				pool->release(key, bytes, ptr);
+			} else {
+				delete ptr;
+			}
+		});
+}
+
+streamfx::obs::gs::rendertarget_pool::statistics streamfx::obs::gs::rendertarget_pool::get_statistics()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	return {_hits, _misses, _targets, _targets_free, _bytes, _bytes_free, _bytes_peak};
+}
+
+void streamfx::obs::gs::rendertarget_pool::release(key_t key, std::size_t bytes,
+												   streamfx::obs::gs::rendertarget* target)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_free[key].push_back({std::unique_ptr<streamfx::obs::gs::rendertarget>(target), current_frame()});
+	_targets_free++;
+	_bytes_free += bytes;
+}
+
+void streamfx::obs::gs::rendertarget_pool::tick()
+{
+	// Targets are released at all times, but only acquired while something renders, so trim here as well.
+	std::vector<entry> expired;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		if (uint32_t frame = current_frame(); frame != _frame) {
+			trim(frame, expired);
+		}
+	}
+	if (!expired.empty()) {
+		auto gctx = streamfx::obs::gs::context();
+		expired.clear();
+	}
+
+#ifdef ENABLE_PROFILING
+	if (auto registry = streamfx::util::profiler_registry::instance(); registry) {
+		auto stats = get_statistics();
+		registry->set_value("rendertarget_pool::hits", static_cast<int64_t>(stats.hits));
+		registry->set_value("rendertarget_pool::misses", static_cast<int64_t>(stats.misses));
+		registry->set_value("rendertarget_pool::targets", static_cast<int64_t>(stats.targets));
+		registry->set_value("rendertarget_pool::targets_free", static_cast<int64_t>(stats.targets_free));
+		registry->set_value("rendertarget_pool::bytes", static_cast<int64_t>(stats.bytes));
+		registry->set_value("rendertarget_pool::bytes_free", static_cast<int64_t>(stats.bytes_free));
+		registry->set_value("rendertarget_pool::bytes_peak", static_cast<int64_t>(stats.bytes_peak));
+	}
+#endif
+}
+
+void streamfx::obs::gs::rendertarget_pool::tick_callback(void* ptr, float)
+{
+	reinterpret_cast<rendertarget_pool*>(ptr)->tick();
+}
+
+void streamfx::obs::gs::rendertarget_pool::trim(uint32_t frame, std::vector<entry>& expired)
+{
+	_frame = frame;
+
+	auto expire = [this, &expired](std::map<key_t, std::vector<entry>>::iterator kv, std::size_t count) {
+		std::size_t bytes = estimate_size(std::get<0>(kv->first), std::get<1>(kv->first), std::get<2>(kv->first),
+										  std::get<3>(kv->first));
+		for (std::size_t idx = 0; idx < count; idx++) {
+			expired.push_back(std::move(kv->second[idx]));
+		}
+		kv->second.erase(kv->second.begin(), kv->second.begin() + static_cast<ptrdiff_t>(count));
+		_targets -= count;
+		_targets_free -= count;
+		_bytes -= bytes * count;
+		_bytes_free -= bytes * count;
+	};
+
+	// Targets which nobody wanted for a while.
+	for (auto kv = _free.begin(); kv != _free.end(); kv++) {
+		auto end = std::find_if(kv->second.begin(), kv->second.end(),
+								[frame](entry& value) { return (frame - value.frame) < ST_POOL_IDLE_FRAMES; });
+		if (auto count = static_cast<std::size_t>(end - kv->second.begin()); count > 0) {
+			expire(kv, count);
+		}
+	}
+
+	// Then the least recently used, until the rest fits.
+	while (_bytes_free > ST_POOL_FREE_LIMIT) {
+		auto oldest = _free.end();
+		for (auto kv = _free.begin(); kv != _free.end(); kv++) {
+			if (kv->second.empty()) {
+				continue;
+			}
+			if ((oldest == _free.end())
+				|| ((frame - kv->second.front().frame) > (frame - oldest->second.front().frame))) {
+				oldest = kv;
+			}
+		}
+		if (oldest == _free.end()) {
+			break;
+		}
+		expire(oldest, 1);
+	}
+
+	for (auto kv = _free.begin(); kv != _free.end();) {
+		if (kv->second.empty()) {
+			kv = _free.erase(kv);
+		} else {
+			kv++;
+		}
+	}
+}
+
+static std::shared_ptr<streamfx::obs::gs::rendertarget_pool> _pool;
+
+void streamfx::obs::gs::rendertarget_pool::initialize()
+{
+	if (!_pool)
+		_pool = std::make_shared<streamfx::obs::gs::rendertarget_pool>();
+}
+
+void streamfx::obs::gs::rendertarget_pool::finalize()
+{
+	_pool.reset();
+}
+
+std::shared_ptr<streamfx::obs::gs::rendertarget_pool> streamfx::obs::gs::rendertarget_pool::instance()
+{
+	return _pool;
+}
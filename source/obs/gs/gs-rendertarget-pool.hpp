@@ -0,0 +1,93 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2017 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include "gs-rendertarget.hpp"
+
+namespace streamfx::obs::gs {
+	/** Render targets shared by everything in the plugin, keyed by size and format.
+	 *
+	 * An acquired render target goes back to the pool once the last reference to it is gone, and targets which have not
+	 * been acquired for a while are destroyed again on the next tick, least recently used first. Hold on to a target
+	 * only for as long as its content is needed, which is usually a single video_render call or a single frame. With
+	 * profiling enabled, the statistics are published to the profiler registry as "rendertarget_pool::<name>".
+	 *
+	 * The content of an acquired render target is undefined, and it must only be rendered to at the size it was
+	 * acquired with.
+	 */
+	class rendertarget_pool {
+		typedef std::tuple<uint32_t, uint32_t, gs_color_format, gs_zstencil_format> key_t;
+
+		struct entry {
+			std::unique_ptr<streamfx::obs::gs::rendertarget> target;
+			uint32_t                                         frame; // Frame it was last released in.
+		};
+
+		std::mutex                          _lock;
+		std::map<key_t, std::vector<entry>> _free;  // Most recently released last.
+		uint32_t                            _frame; // Frame the pool was last trimmed in.
+
+		uint64_t    _hits;
+		uint64_t    _misses;
+		std::size_t _targets;
+		std::size_t _targets_free;
+		std::size_t _bytes;
+		std::size_t _bytes_free;
+		std::size_t _bytes_peak;
+
+		public:
+		struct statistics {
+			uint64_t    hits;         // Acquired from the pool.
+			uint64_t    misses;       // Had to be created.
+			std::size_t targets;      // Currently alive, in use or not.
+			std::size_t targets_free; // Currently waiting in the pool.
+			std::size_t bytes;        // Estimated video memory of all targets.
+			std::size_t bytes_free;   // Estimated video memory of the targets waiting in the pool.
+			std::size_t bytes_peak;
+		};
+
+		~rendertarget_pool();
+		rendertarget_pool();
+
+		std::shared_ptr<streamfx::obs::gs::rendertarget> acquire(uint32_t width, uint32_t height,
+																 gs_color_format    color_format,
+																 gs_zstencil_format zstencil_format = GS_ZS_NONE);
+
+		statistics get_statistics();
+
+		private:
+		void release(key_t key, std::size_t bytes, streamfx::obs::gs::rendertarget* target);
+
+		void trim(uint32_t frame, std::vector<entry>& expired);
+
+		void tick();
+
+		static void tick_callback(void* ptr, float seconds);
+
+		public /* Singleton */:
+		static void                                                     initialize();
+		static void                                                     finalize();
+		static std::shared_ptr<::streamfx::obs::gs::rendertarget_pool> instance();
+	};
+} // namespace streamfx::obs::gs
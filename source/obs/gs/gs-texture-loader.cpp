@@ -0,0 +1,285 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2017 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gs-texture-loader.hpp"
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include "obs/gs/gs-helper.hpp"
+#include "plugin.hpp"
+#include "util/util-logging.hpp"
+#include "util/util-platform.hpp"
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<gs::texture_loader> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+// Time per tick that may be spent uploading decoded textures. At least one texture is uploaded per tick regardless.
+#define ST_UPLOAD_BUDGET std::chrono::milliseconds(2)
+
+streamfx::obs::gs::texture_loader::request::request(std::filesystem::path file)
+	: _lock(), _file(file), _done(false), _texture(), _error()
+{}
+
+streamfx::obs::gs::texture_loader::request::~request() = default;
+
+const std::filesystem::path& streamfx::obs::gs::texture_loader::request::get_file()
+{
+	return _file;
+}
+
+bool streamfx::obs::gs::texture_loader::request::is_done()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	return _done;
+}
+
+std::shared_ptr<streamfx::obs::gs::texture> streamfx::obs::gs::texture_loader::request::get_texture()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	if (_done && !_texture) {
+		throw std::runtime_error(_error);
+	}
+	return _texture;
+}
+
+void streamfx::obs::gs::texture_loader::request::finish(std::shared_ptr<streamfx::obs::gs::texture> texture,
+														 std::string                                 error)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_texture = texture;
+	_error   = error;
+	_done    = true;
+}
+
+streamfx::obs::gs::texture_loader::~texture_loader()
+{
+	obs_remove_tick_callback(tick_callback, this);
+
+	// Anything that was not uploaded yet is lost.
+	{
+		auto gctx = streamfx::obs::gs::context();
+		for (auto& entry : _uploads) {
+			entry.target->finish(nullptr, "Texture loader was shut down.");
+		}
+		_uploads.clear();
+	}
+
+	D_LOG_INFO("%" PRIu64 " textures were decoded, and %" PRIu64 " shared with an existing texture.", _decoded,
+			   _shared);
+}
+
+streamfx::obs::gs::texture_loader::texture_loader()
+	: _lock(), _requests(), _textures(), _uploads(), _decoded(0), _shared(0)
+{
+	obs_add_tick_callback(tick_callback, this);
+}
+
+std::shared_ptr<streamfx::obs::gs::texture_loader::request>
+	streamfx::obs::gs::texture_loader::load(std::filesystem::path file)
+{
+	// Changed files must be loaded again, so the key includes the modification time and size.
+	std::string key;
+	{
+		std::error_code ec;
+		auto            path = std::filesystem::weakly_canonical(std::filesystem::absolute(file, ec), ec);
+		auto            time = std::filesystem::last_write_time(path, ec);
+		auto            size = std::filesystem::file_size(path, ec);
+		if (ec) {
+			// Let the thread pool report the error, like it would for any other failure.
+			key = file.generic_u8string();
+		} else {
+			key = path.generic_u8string() + "|" + std::to_string(time.time_since_epoch().count()) + "|"
+				  + std::to_string(size);
+		}
+	}
+
+	std::shared_ptr<request> target;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+
+		// Forget about requests nobody waits for anymore.
+		for (auto kv = _requests.begin(); kv != _requests.end();) {
+			if (kv->second.expired()) {
+				kv = _requests.erase(kv);
+			} else {
+				kv++;
+			}
+		}
+
+		if (auto kv = _requests.find(key); kv != _requests.end()) {
+			if (auto existing = kv->second.lock(); existing) {
+				return existing;
+			}
+		}
+
+		target = std::make_shared<request>(file);
+		_requests.insert_or_assign(key, target);
+	}
+
+	std::weak_ptr<texture_loader> self = instance();
+	streamfx::threadpool()->push(
+		[self, target](streamfx::util::threadpool_data_t) {
+			if (auto loader = self.lock(); loader) {
+				loader->decode(target);
+			} else {
+				target->finish(nullptr, "Texture loader was shut down.");
+			}
+		},
+		nullptr, streamfx::util::threadpool_priority::BACKGROUND);
+
+	return target;
+}
+
+void streamfx::obs::gs::texture_loader::decode(std::shared_ptr<request> target)
+try {
+	const std::string file = streamfx::util::platform::native_to_utf8(target->get_file()).generic_u8string();
+
+	// Identify the file by its content, so that copies of it share a texture.
+	content_key_t key;
+	{
+		std::ifstream ifs(target->get_file(), std::ios::in | std::ios::binary);
+		if (!ifs.is_open() || ifs.bad()) {
+			throw std::ios_base::failure(file);
+		}
+		std::string content{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+		key = {std::hash<std::string>{}(content), content.size()};
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		if (auto kv = _textures.find(key); kv != _textures.end()) {
+			if (auto texture = kv->second.lock(); texture) {
+				_shared++;
+				target->finish(texture, "");
+				return;
+			}
+		}
+	}
+
+	// Decoding does not need the graphics context, only the upload does.
+	auto image = std::shared_ptr<gs_image_file_t>(new gs_image_file_t{}, [](gs_image_file_t* ptr) {
+		auto gctx = streamfx::obs::gs::context();
+		gs_image_file_free(ptr);
+		delete ptr;
+	});
+	gs_image_file_init(image.get(), file.c_str());
+	if (!image->loaded) {
+		throw std::runtime_error("Failed to decode image.");
+	}
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_uploads.push_back({target, image, key});
+} catch (const std::exception& ex) {
+	D_LOG_ERROR("Failed to load '%s': %s", target->get_file().u8string().c_str(), ex.what());
+	target->finish(nullptr, ex.what());
+}
+
+void streamfx::obs::gs::texture_loader::tick()
+{
+	auto start = std::chrono::steady_clock::now();
+	do {
+		upload entry;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			if (_uploads.empty()) {
+				break;
+			}
+			entry = _uploads.front();
+			_uploads.pop_front();
+		}
+
+		// Someone else may have finished the same content in the meantime.
+		std::shared_ptr<streamfx::obs::gs::texture> texture;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			if (auto kv = _textures.find(entry.key); kv != _textures.end()) {
+				texture = kv->second.lock();
+			}
+		}
+
+		if (texture) {
+			std::unique_lock<std::mutex> lock(_lock);
+			_shared++;
+		} else {
+			auto gctx = streamfx::obs::gs::context();
+			gs_image_file_init_texture(entry.image.get());
+			if (entry.image->texture) {
+				texture              = std::make_shared<streamfx::obs::gs::texture>(entry.image->texture, true);
+				entry.image->texture = nullptr; // Owned by the texture now.
+			}
+
+			std::unique_lock<std::mutex> lock(_lock);
+			if (texture) {
+				_textures.insert_or_assign(entry.key, texture);
+				_decoded++;
+			}
+		}
+
+		if (texture) {
+			entry.target->finish(texture, "");
+		} else {
+			D_LOG_ERROR("Failed to upload '%s'.", entry.target->get_file().u8string().c_str());
+			entry.target->finish(nullptr, "Failed to upload texture.");
+		}
+	} while ((std::chrono::steady_clock::now() - start) < ST_UPLOAD_BUDGET);
+
+	// Forget about textures nobody uses anymore.
+	std::unique_lock<std::mutex> lock(_lock);
+	for (auto kv = _textures.begin(); kv != _textures.end();) {
+		if (kv->second.expired()) {
+			kv = _textures.erase(kv);
+		} else {
+			kv++;
+		}
+	}
+}
+
+void streamfx::obs::gs::texture_loader::tick_callback(void* ptr, float)
+{
+	reinterpret_cast<texture_loader*>(ptr)->tick();
+}
+
+static std::shared_ptr<streamfx::obs::gs::texture_loader> _loader;
+
+void streamfx::obs::gs::texture_loader::initialize()
+{
+	if (!_loader)
+		_loader = std::make_shared<streamfx::obs::gs::texture_loader>();
+}
+
+void streamfx::obs::gs::texture_loader::finalize()
+{
+	_loader.reset();
+}
+
+std::shared_ptr<streamfx::obs::gs::texture_loader> streamfx::obs::gs::texture_loader::instance()
+{
+	return _loader;
+}
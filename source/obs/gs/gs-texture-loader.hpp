@@ -0,0 +1,115 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2017 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <filesystem>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include "gs-texture.hpp"
+
+extern "C" {
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/image-file.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+}
+
+namespace streamfx::obs::gs {
+	/** Loads textures from files without stalling the graphics thread.
+	 *
+	 * Files are decoded on the thread pool, and uploaded on the graphics thread during the next ticks, a few at a
+	 * time. Identical files are only decoded and uploaded once, even if they are at different paths, and share the
+	 * resulting texture for as long as anyone uses it.
+	 *
+	 * Users are expected to poll their request, and keep using whatever texture they had until it is done.
+	 */
+	class texture_loader {
+		public:
+		class request {
+			friend class texture_loader;
+
+			std::mutex                                  _lock;
+			std::filesystem::path                       _file;
+			bool                                        _done;
+			std::shared_ptr<streamfx::obs::gs::texture> _texture;
+			std::string                                 _error;
+
+			public:
+			request(std::filesystem::path file);
+			~request();
+
+			const std::filesystem::path& get_file();
+
+			/** Check if loading has finished, successfully or not. */
+			bool is_done();
+
+			/** Retrieve the loaded texture, or nullptr if it is still loading.
+			 *
+			 * @throws std::runtime_error if the file could not be loaded.
+			 */
+			std::shared_ptr<streamfx::obs::gs::texture> get_texture();
+
+			private:
+			void finish(std::shared_ptr<streamfx::obs::gs::texture> texture, std::string error);
+		};
+
+		private:
+		typedef std::pair<std::size_t, std::size_t> content_key_t; // Content hash and size.
+
+		struct upload {
+			std::shared_ptr<request>         target;
+			std::shared_ptr<gs_image_file_t> image;
+			content_key_t                    key;
+		};
+
+		std::mutex                                                         _lock;
+		std::map<std::string, std::weak_ptr<request>>                      _requests; // Path, time and size.
+		std::map<content_key_t, std::weak_ptr<streamfx::obs::gs::texture>> _textures;
+		std::list<upload>                                                  _uploads;
+
+		uint64_t _decoded;
+		uint64_t _shared;
+
+		public:
+		~texture_loader();
+		texture_loader();
+
+		/** Start loading a file, or join an already running load of the same unchanged file. */
+		std::shared_ptr<request> load(std::filesystem::path file);
+
+		private:
+		void decode(std::shared_ptr<request> target);
+
+		void tick();
+
+		static void tick_callback(void* ptr, float seconds);
+
+		public /* Singleton */:
+		static void                                                  initialize();
+		static void                                                  finalize();
+		static std::shared_ptr<::streamfx::obs::gs::texture_loader> instance();
+	};
+} // namespace streamfx::obs::gs
@@ -21,6 +21,10 @@
 #include "common.hpp"
 #include "plugin.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "util/util-profiler.hpp"
+#endif
+
 namespace streamfx::obs {
 	class encoder_instance {
 		protected:
@@ -103,6 +107,10 @@ namespace streamfx::obs {
 		std::map<std::string, std::shared_ptr<obs_encoder_info>> _proxies;
 		std::set<std::string>                                    _proxy_names;
 
+#ifdef ENABLE_PROFILING
+		std::shared_ptr<::streamfx::util::profiler> _profiler_encode;
+#endif
+
 		public:
 		encoder_factory()
 		{
@@ -122,6 +130,11 @@ namespace streamfx::obs {
 
 		void finish_setup()
 		{
+#ifdef ENABLE_PROFILING
+			// Shared by all instances (and the fallback) of this type, named after the type.
+			_profiler_encode = ::streamfx::util::profiler_registry::get(std::string(_info.id) + "::encode");
+#endif
+
 			if (_info.type == OBS_ENCODER_AUDIO) {
 				_info.get_frame_size = _get_frame_size;
 				_info.get_audio_info = _get_audio_info;
@@ -289,11 +302,23 @@ namespace streamfx::obs {
 			return false;
 		}
 
+#ifdef ENABLE_PROFILING
+		static encoder_factory* _type_data(void* data)
+		{
+			return reinterpret_cast<encoder_factory*>(
+				obs_encoder_get_type_data(reinterpret_cast<encoder_instance*>(data)->get()));
+		}
+#endif
+
 		static bool _encode(void* data, struct encoder_frame* frame, struct encoder_packet* packet,
 							bool* received_packet) noexcept
 		try {
-			if (data)
+			if (data) {
+#ifdef ENABLE_PROFILING
+				auto profile = _type_data(data)->_profiler_encode->track();
+#endif
 				return reinterpret_cast<encoder_instance*>(data)->encode_video(frame, packet, received_packet);
+			}
 			return false;
 		} catch (const std::exception& ex) {
 			DLOG_ERROR("Unexpected exception in function '%s': %s.", __FUNCTION_NAME__, ex.what());
@@ -306,9 +331,13 @@ namespace streamfx::obs {
 		static bool _encode_texture(void* data, uint32_t handle, int64_t pts, uint64_t lock_key, uint64_t* next_key,
 									struct encoder_packet* packet, bool* received_packet) noexcept
 		try {
-			if (data)
+			if (data) {
+#ifdef ENABLE_PROFILING
+				auto profile = _type_data(data)->_profiler_encode->track();
+#endif
 				return reinterpret_cast<encoder_instance*>(data)->encode_video(handle, pts, lock_key, next_key, packet,
 																			   received_packet);
+			}
 			return false;
 		} catch (const std::exception& ex) {
 			DLOG_ERROR("Unexpected exception in function '%s': %s.", __FUNCTION_NAME__, ex.what());
@@ -21,6 +21,10 @@
 #include "common.hpp"
 #include "obs-source.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "util/util-profiler.hpp"
+#endif
+
 namespace streamfx::obs {
 	template<class _factory, typename _instance>
 	class source_factory {
@@ -29,6 +33,11 @@ namespace streamfx::obs {
 		std::map<std::string, std::shared_ptr<obs_source_info>> _proxies;
 		std::set<std::string>                                   _proxy_names;
 
+#ifdef ENABLE_PROFILING
+		std::shared_ptr<::streamfx::util::profiler> _profiler_video_tick;
+		std::shared_ptr<::streamfx::util::profiler> _profiler_video_render;
+#endif
+
 		public:
 		source_factory(obs_source_type type = OBS_SOURCE_TYPE_INPUT)
 		{
@@ -124,6 +133,12 @@ namespace streamfx::obs {
 				_info.audio_mix = _audio_mix;
 			}
 
+#ifdef ENABLE_PROFILING
+			// Shared by all instances (and proxies) of this type, named after the type.
+			_profiler_video_tick   = ::streamfx::util::profiler_registry::get(std::string(_info.id) + "::video_tick");
+			_profiler_video_render = ::streamfx::util::profiler_registry::get(std::string(_info.id) + "::video_render");
+#endif
+
 			obs_register_source(&_info);
 		}
 
@@ -222,12 +237,24 @@ namespace streamfx::obs {
 			}
 		}
 
+#ifdef ENABLE_PROFILING
+		static source_factory* _type_data(void* data)
+		{
+			return reinterpret_cast<source_factory*>(
+				obs_source_get_type_data(reinterpret_cast<_instance*>(data)->get()));
+		}
+#endif
+
 		public /* Instance > Video */:
 		static void _video_tick(void* data, float seconds) noexcept
 		{
 			try {
-				if (data)
+				if (data) {
+#ifdef ENABLE_PROFILING
+					auto profile = _type_data(data)->_profiler_video_tick->track();
+#endif
 					reinterpret_cast<_instance*>(data)->video_tick(seconds);
+				}
 			} catch (const std::exception& ex) {
 				DLOG_ERROR("Unexpected exception in function '%s': %s.", __FUNCTION_NAME__, ex.what());
 			} catch (...) {
@@ -238,8 +265,12 @@ namespace streamfx::obs {
 		static void _video_render(void* data, gs_effect_t* effect) noexcept
 		{
 			try {
-				if (data)
+				if (data) {
+#ifdef ENABLE_PROFILING
+					auto profile = _type_data(data)->_profiler_video_render->track();
+#endif
 					reinterpret_cast<_instance*>(data)->video_render(effect);
+				}
 			} catch (const std::exception& ex) {
 				DLOG_ERROR("Unexpected exception in function '%s': %s.", __FUNCTION_NAME__, ex.what());
 			} catch (...) {
@@ -250,8 +281,12 @@ namespace streamfx::obs {
 		static void _video_render_filter(void* data, gs_effect_t* effect) noexcept
 		{
 			try {
-				if (data)
+				if (data) {
+#ifdef ENABLE_PROFILING
+					auto profile = _type_data(data)->_profiler_video_render->track();
+#endif
 					reinterpret_cast<_instance*>(data)->video_render(effect);
+				}
 			} catch (const std::exception& ex) {
 				DLOG_ERROR("Unexpected exception in function '%s': %s.", __FUNCTION_NAME__, ex.what());
 				obs_source_skip_video_filter(reinterpret_cast<_instance*>(data)->get());
@@ -18,14 +18,23 @@
 */
 
 #include "plugin.hpp"
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 #include "configuration.hpp"
 #include "gfx/gfx-opengl.hpp"
+#include "obs/gs/gs-effect-cache.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
+#include "obs/gs/gs-texture-loader.hpp"
 #include "obs/gs/gs-vertexbuffer.hpp"
 #include "obs/obs-source-tracker.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "benchmark/benchmark.hpp"
+#include "util/util-trace.hpp"
+#endif
+
 #ifdef ENABLE_NVIDIA_CUDA
 #include "nvidia/cuda/nvidia-cuda-obs.hpp"
 #endif
@@ -91,6 +100,11 @@
 //static std::shared_ptr<streamfx::updater> _updater;
 #endif
 
+#define ST_CFG_THREADPOOL_WORKERS "threadpool.workers"
+#define ST_CFG_THREADPOOL_LIMIT_REALTIME "threadpool.limit.realtime"
+#define ST_CFG_THREADPOOL_LIMIT_NORMAL "threadpool.limit.normal"
+#define ST_CFG_THREADPOOL_LIMIT_BACKGROUND "threadpool.limit.background"
+
 static std::shared_ptr<streamfx::util::threadpool>       _threadpool;
 static std::shared_ptr<streamfx::obs::gs::vertex_buffer> _gs_fstri_vb;
 static std::shared_ptr<streamfx::gfx::opengl>            _streamfx_gfx_opengl;
@@ -104,11 +118,53 @@ try {
 	streamfx::configuration::initialize();
 
 	// Initialize global Thread Pool.
-	_threadpool = std::make_shared<streamfx::util::threadpool>();
+	if (auto config = streamfx::configuration::instance(); config) {
+		auto dataptr = config->get();
+
+		std::size_t workers = 0;
+		if (obs_data_has_user_value(dataptr.get(), ST_CFG_THREADPOOL_WORKERS))
+			workers = static_cast<std::size_t>(
+				std::max<long long>(obs_data_get_int(dataptr.get(), ST_CFG_THREADPOOL_WORKERS), 0));
+		_threadpool = std::make_shared<streamfx::util::threadpool>(workers);
+
+		// Allow users to override how many workers each priority class may occupy.
+		std::pair<const char*, streamfx::util::threadpool_priority> limits[] = {
+			{ST_CFG_THREADPOOL_LIMIT_REALTIME, streamfx::util::threadpool_priority::REALTIME},
+			{ST_CFG_THREADPOOL_LIMIT_NORMAL, streamfx::util::threadpool_priority::NORMAL},
+			{ST_CFG_THREADPOOL_LIMIT_BACKGROUND, streamfx::util::threadpool_priority::BACKGROUND},
+		};
+		for (auto& kv : limits) {
+			if (obs_data_has_user_value(dataptr.get(), kv.first))
+				_threadpool->limit(kv.second, static_cast<std::size_t>(
+												  std::max<long long>(obs_data_get_int(dataptr.get(), kv.first), 1)));
+		}
+	} else {
+		_threadpool = std::make_shared<streamfx::util::threadpool>();
+	}
+
+#ifdef ENABLE_PROFILING
+	// Initialize Tracer
+	streamfx::util::tracer::initialize();
+
+	// Initialize Profiler Registry
+	streamfx::util::profiler_registry::initialize();
+
+	// Initialize GPU Timing
+	streamfx::obs::gs::debug_timing::initialize();
+#endif
 
 	// Initialize Source Tracker
 	_source_tracker = streamfx::obs::source_tracker::get();
 
+	// Initialize Render Target Pool
+	streamfx::obs::gs::rendertarget_pool::initialize();
+
+	// Initialize Effect Cache
+	streamfx::obs::gs::effect_cache::initialize();
+
+	// Initialize Texture Loader
+	streamfx::obs::gs::texture_loader::initialize();
+
 	// Initialize GLAD (OpenGL)
 	{
 		streamfx::obs::gs::context gctx{};
@@ -230,6 +286,11 @@ MODULE_EXPORT void obs_module_unload(void)
 try {
 	DLOG_INFO("Unloading Version %s", STREAMFX_VERSION_STRING);
 
+#ifdef ENABLE_PROFILING
+	// Benchmarks use almost everything below, so they have to stop first.
+	streamfx::benchmark::finalize();
+#endif
+
 	// Frontend
 #ifdef ENABLE_FRONTEND
 	streamfx::ui::handler::finalize();
@@ -301,7 +362,13 @@ try {
 
 	// GS Stuff
 	{
+		streamfx::obs::gs::texture_loader::finalize();
+		streamfx::obs::gs::effect_cache::finalize();
+		streamfx::obs::gs::rendertarget_pool::finalize();
 		_gs_fstri_vb.reset();
+#ifdef ENABLE_PROFILING
+		streamfx::obs::gs::debug_timing::finalize();
+#endif
 	}
 
 	// Finalize GLAD (OpenGL)
@@ -321,6 +388,12 @@ try {
 	// Finalize Thread Pool
 	_threadpool.reset();
 
+#ifdef ENABLE_PROFILING
+	// Finalize Profiler Registry and Tracer, which thread pool tasks may still have used until now.
+	streamfx::util::profiler_registry::finalize();
+	streamfx::util::tracer::finalize();
+#endif
+
 	// Finalize Configuration
 	streamfx::configuration::finalize();
 
@@ -25,6 +25,14 @@
 #include "obs/obs-tools.hpp"
 #include "plugin.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "benchmark/benchmark-encoders.hpp"
+#include "benchmark/benchmark-filters.hpp"
+#include "benchmark/benchmark-threadpool.hpp"
+#include "benchmark/benchmark.hpp"
+#include "util/util-trace.hpp"
+#endif
+
 #include <obs-frontend-api.h>
 
 // Translation Keys
@@ -38,9 +46,14 @@ constexpr std::string_view _i18n_menu_youtube = "UI.Menu.YouTube";
 constexpr std::string_view _i18n_menu_twitter = "UI.Menu.Twitter";
 constexpr std::string_view _i18n_menu_github  = "UI.Menu.Github";
 constexpr std::string_view _i18n_menu_about   = "UI.Menu.About";
+constexpr std::string_view _i18n_menu_trace   = "UI.Menu.SaveTrace";
+constexpr std::string_view _i18n_menu_bench   = "UI.Menu.BenchmarkFilters";
+constexpr std::string_view _i18n_menu_encode  = "UI.Menu.BenchmarkEncoders";
+constexpr std::string_view _i18n_menu_pool    = "UI.Menu.BenchmarkThreadPool";
 
 // Configuration
 constexpr std::string_view _cfg_have_shown_about = "UI.HaveShownAboutStreamFX";
+constexpr std::string_view _cfg_benchmark        = "benchmark.autorun";
 
 // URLs
 constexpr std::string_view _url_support = "https://s.xaymar.com/streamfx-dc-support";
@@ -79,6 +92,10 @@ streamfx::ui::handler::handler()
 
 	  _action_support(), _action_wiki(), _action_website(), _action_discord(), _action_twitter(), _action_youtube(),
 
+#ifdef ENABLE_PROFILING
+	  _action_trace(), _action_benchmark_filters(), _action_benchmark_encoders(), _action_benchmark_threadpool(),
+#endif
+
 	  _about_action(), _about_dialog(),
 
 	  _translator()
@@ -173,6 +190,28 @@ void streamfx::ui::handler::on_obs_loaded()
 		_updater = streamfx::ui::updater::instance(_menu);
 #endif
 
+		// Profiling Tools
+#ifdef ENABLE_PROFILING
+		_menu->addSeparator();
+		if (streamfx::util::tracer::instance()) { // Only available while recording.
+			_action_trace = _menu->addAction(QString::fromUtf8(D_TRANSLATE(_i18n_menu_trace.data())));
+			_action_trace->setMenuRole(QAction::NoRole);
+			connect(_action_trace, &QAction::triggered, this, &streamfx::ui::handler::on_action_trace);
+		}
+		_action_benchmark_filters = _menu->addAction(QString::fromUtf8(D_TRANSLATE(_i18n_menu_bench.data())));
+		_action_benchmark_filters->setMenuRole(QAction::NoRole);
+		connect(_action_benchmark_filters, &QAction::triggered, this,
+				&streamfx::ui::handler::on_action_benchmark_filters);
+		_action_benchmark_encoders = _menu->addAction(QString::fromUtf8(D_TRANSLATE(_i18n_menu_encode.data())));
+		_action_benchmark_encoders->setMenuRole(QAction::NoRole);
+		connect(_action_benchmark_encoders, &QAction::triggered, this,
+				&streamfx::ui::handler::on_action_benchmark_encoders);
+		_action_benchmark_threadpool = _menu->addAction(QString::fromUtf8(D_TRANSLATE(_i18n_menu_pool.data())));
+		_action_benchmark_threadpool->setMenuRole(QAction::NoRole);
+		connect(_action_benchmark_threadpool, &QAction::triggered, this,
+				&streamfx::ui::handler::on_action_benchmark_threadpool);
+#endif
+
 		_menu->addSeparator();
 
 		// About
@@ -209,6 +248,24 @@ void streamfx::ui::handler::on_obs_loaded()
 #ifdef ENABLE_UPDATER
 	this->_updater->obs_ready();
 #endif
+
+#ifdef ENABLE_PROFILING
+	// Unattended benchmark runs, for example on build machines.
+	{
+		auto data = streamfx::configuration::instance()->get();
+		if (obs_data_get_bool(data.get(), _cfg_benchmark.data())) {
+			// One after the other, so that they don't compete for the CPU.
+			auto filters  = streamfx::config_file_path("benchmark-filters.json");
+			auto encoders = streamfx::config_file_path("benchmark-encoders.json");
+			auto pool     = streamfx::config_file_path("benchmark-threadpool.json");
+			streamfx::benchmark::run([filters, encoders, pool]() {
+				streamfx::benchmark::run_filters(filters);
+				streamfx::benchmark::run_encoders(encoders);
+				streamfx::benchmark::run_threadpool(pool);
+			});
+		}
+	}
+#endif
 }
 
 void streamfx::ui::handler::on_obs_exit()
@@ -250,6 +307,39 @@ void streamfx::ui::handler::on_action_youtube(bool)
 	QDesktopServices::openUrl(QUrl(QString::fromUtf8(_url_youtube.data())));
 }
 
+#ifdef ENABLE_PROFILING
+void streamfx::ui::handler::on_action_trace(bool)
+{
+	// Writing a few megabytes takes a while, so keep it away from the UI.
+	auto path = streamfx::config_file_path("trace-" + std::to_string(time(nullptr)) + ".json");
+	streamfx::threadpool()->push(
+		[path](streamfx::util::threadpool_data_t) {
+			if (auto tracer = streamfx::util::tracer::instance(); tracer) {
+				tracer->save(path);
+			}
+		},
+		nullptr, streamfx::util::threadpool_priority::BACKGROUND);
+}
+
+void streamfx::ui::handler::on_action_benchmark_filters(bool)
+{
+	auto path = streamfx::config_file_path("benchmark-filters.json");
+	streamfx::benchmark::run([path]() { streamfx::benchmark::run_filters(path); });
+}
+
+void streamfx::ui::handler::on_action_benchmark_encoders(bool)
+{
+	auto path = streamfx::config_file_path("benchmark-encoders.json");
+	streamfx::benchmark::run([path]() { streamfx::benchmark::run_encoders(path); });
+}
+
+void streamfx::ui::handler::on_action_benchmark_threadpool(bool)
+{
+	auto path = streamfx::config_file_path("benchmark-threadpool.json");
+	streamfx::benchmark::run([path]() { streamfx::benchmark::run_threadpool(path); });
+}
+#endif
+
 void streamfx::ui::handler::on_action_about(bool checked)
 {
 	_about_dialog->show();
@@ -41,6 +41,13 @@ namespace streamfx::ui {
 		QAction* _action_twitter;
 		QAction* _action_youtube;
 
+#ifdef ENABLE_PROFILING
+		QAction* _action_trace;
+		QAction* _action_benchmark_filters;
+		QAction* _action_benchmark_encoders;
+		QAction* _action_benchmark_threadpool;
+#endif
+
 		// About Dialog
 		QAction*   _about_action;
 		ui::about* _about_dialog;
@@ -74,6 +81,13 @@ namespace streamfx::ui {
 		void on_action_twitter(bool);
 		void on_action_youtube(bool);
 
+#ifdef ENABLE_PROFILING
+		void on_action_trace(bool);
+		void on_action_benchmark_filters(bool);
+		void on_action_benchmark_encoders(bool);
+		void on_action_benchmark_threadpool(bool);
+#endif
+
 		// About
 		void on_action_about(bool);
 
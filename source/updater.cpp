@@ -492,7 +492,8 @@ void streamfx::updater::refresh()
 		save();
 
 		// Spawn a new task.
-		_task = streamfx::threadpool()->push(std::bind(&streamfx::updater::task, this, std::placeholders::_1), nullptr);
+		_task = streamfx::threadpool()->push(std::bind(&streamfx::updater::task, this, std::placeholders::_1), nullptr,
+											 streamfx::util::threadpool_priority::BACKGROUND);
 	} else {
 		events.refreshed(*this);
 	}
@@ -18,9 +18,51 @@
  */
 
 #include "util-profiler.hpp"
-#include <iterator>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "configuration.hpp"
+#include "plugin.hpp"
+#include "util/util-logging.hpp"
+#include "util/util-trace.hpp"
 
-streamfx::util::profiler::profiler() {}
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<util::profiler> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+#define ST_CFG_INTERVAL "profiler.interval"
+#define ST_CFG_FORMAT "profiler.format"
+
+// Reports are written once a minute by default, and the file is rolled over once it grows past the size limit.
+#define ST_REPORT_INTERVAL 60
+#define ST_REPORT_SIZE_LIMIT (8 * 1024 * 1024)
+
+streamfx::util::profiler::profiler(std::string_view name)
+	: _shards(new shard[histogram_shards]), _minimum(std::numeric_limits<uint64_t>::max()), _maximum(0),
+	  _trace_name(name.empty() ? std::numeric_limits<uint32_t>::max() : streamfx::util::tracer::intern(name))
+{
+	for (std::size_t idx = 0; idx < histogram_shards; idx++) {
+		auto& shard = _shards[idx];
+		shard.count.store(0, std::memory_order_relaxed);
+		shard.total.store(0, std::memory_order_relaxed);
+		for (auto& bucket : shard.buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+}
 
 streamfx::util::profiler::~profiler() {}
 
@@ -31,117 +73,130 @@ std::shared_ptr<streamfx::util::profiler::instance> streamfx::util::profiler::tr
 
 void streamfx::util::profiler::track(std::chrono::nanoseconds duration)
 {
-	std::unique_lock<std::mutex> ul(_timings_lock);
-	auto                         itr = _timings.find(duration);
-	if (itr == _timings.end()) {
-		_timings.emplace(duration, 1u);
-	} else {
-		itr->second++;
+	// Each thread sticks to the same shard.
+	static thread_local std::size_t local_shard = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+	uint64_t value = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+	auto&    shard = _shards[local_shard % histogram_shards];
+	shard.buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+	shard.total.fetch_add(value, std::memory_order_relaxed);
+	shard.count.fetch_add(1, std::memory_order_relaxed);
+
+	for (uint64_t cur = _minimum.load(std::memory_order_relaxed); (value < cur);) {
+		if (_minimum.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+			break;
+	}
+	for (uint64_t cur = _maximum.load(std::memory_order_relaxed); (value > cur);) {
+		if (_maximum.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+			break;
 	}
 }
 
 uint64_t streamfx::util::profiler::count()
 {
 	uint64_t count = 0;
-
-	std::map<std::chrono::nanoseconds, size_t> copy_timings;
-	{
-		std::unique_lock<std::mutex> ul(_timings_lock);
-		copy(_timings.begin(), _timings.end(), std::inserter(copy_timings, copy_timings.end()));
-	}
-
-	for (auto kv : copy_timings) {
-		count += kv.second;
+	for (std::size_t idx = 0; idx < histogram_shards; idx++) {
+		count += _shards[idx].count.load(std::memory_order_relaxed);
 	}
-
 	return count;
 }
 
 std::chrono::nanoseconds streamfx::util::profiler::total_duration()
 {
-	std::chrono::nanoseconds duration{0};
-
-	std::map<std::chrono::nanoseconds, size_t> copy_timings;
-	{
-		std::unique_lock<std::mutex> ul(_timings_lock);
-		copy(_timings.begin(), _timings.end(), std::inserter(copy_timings, copy_timings.end()));
-	}
-
-	for (auto kv : copy_timings) {
-		duration += kv.first * kv.second;
+	uint64_t total = 0;
+	for (std::size_t idx = 0; idx < histogram_shards; idx++) {
+		total += _shards[idx].total.load(std::memory_order_relaxed);
 	}
-
-	return duration;
+	return std::chrono::nanoseconds(total);
 }
 
 double_t streamfx::util::profiler::average_duration()
 {
-	std::chrono::nanoseconds duration{0};
-	uint64_t                 count = 0;
+	return double_t(total_duration().count()) / double_t(count());
+}
 
-	std::map<std::chrono::nanoseconds, size_t> copy_timings;
-	{
-		std::unique_lock<std::mutex> ul(_timings_lock);
-		copy(_timings.begin(), _timings.end(), std::inserter(copy_timings, copy_timings.end()));
+std::chrono::nanoseconds streamfx::util::profiler::percentile(double_t percentile, bool by_time)
+{
+	uint64_t calls = count();
+	if (calls == 0) {
+		return std::chrono::nanoseconds(-1);
+	}
+
+	uint64_t smallest = _minimum.load(std::memory_order_relaxed);
+	uint64_t largest  = _maximum.load(std::memory_order_relaxed);
+	if (percentile <= 0.0) {
+		return std::chrono::nanoseconds(smallest);
+	} else if (percentile >= 1.0) {
+		return std::chrono::nanoseconds(largest);
 	}
 
-	for (auto kv : copy_timings) {
-		duration += kv.first * kv.second;
-		count += kv.second;
+	// Buckets report their center, clamped to what was actually recorded.
+	auto result = [smallest, largest](std::size_t index) {
+		uint64_t lower = bucket_value(index);
+		uint64_t upper = bucket_value(index + 1);
+		return std::chrono::nanoseconds(std::clamp<uint64_t>(lower + (upper - lower) / 2, smallest, largest));
+	};
+
+	if (by_time) { // Return by time percentile.
+		uint64_t threshold = smallest + static_cast<uint64_t>(double_t(largest - smallest) * percentile);
+		for (std::size_t index = 0; index < histogram_buckets; index++) {
+			if (bucket_value(index + 1) <= threshold) {
+				continue;
+			}
+			for (std::size_t idx = 0; idx < histogram_shards; idx++) {
+				if (_shards[idx].buckets[index].load(std::memory_order_relaxed) > 0) {
+					return result(index);
+				}
+			}
+		}
+	} else { // Return by call percentile.
+		uint64_t threshold = static_cast<uint64_t>(double_t(calls) * percentile);
+		uint64_t accu      = 0;
+		for (std::size_t index = 0; index < histogram_buckets; index++) {
+			for (std::size_t idx = 0; idx < histogram_shards; idx++) {
+				accu += _shards[idx].buckets[index].load(std::memory_order_relaxed);
+			}
+			if (accu > threshold) {
+				return result(index);
+			}
+		}
 	}
 
-	return double_t(duration.count()) / double_t(count);
+	return std::chrono::nanoseconds(largest);
 }
 
-template<typename T>
-inline bool is_equal(T a, T b, T c)
+std::chrono::nanoseconds streamfx::util::profiler::maximum()
 {
-	return (a == b) || ((a >= (b - c)) && (a <= (b + c)));
+	return std::chrono::nanoseconds(_maximum.load(std::memory_order_relaxed));
 }
 
-std::chrono::nanoseconds streamfx::util::profiler::percentile(double_t percentile, bool by_time)
+std::size_t streamfx::util::profiler::bucket_index(uint64_t value)
 {
-	constexpr double_t edge  = 0.00005;
-	uint64_t           calls = count();
-
-	std::map<std::chrono::nanoseconds, size_t> copy_timings;
-	{
-		std::unique_lock<std::mutex> ul(_timings_lock);
-		copy(_timings.begin(), _timings.end(), inserter(copy_timings, copy_timings.end()));
+	constexpr uint64_t linear = uint64_t(1) << histogram_bits;
+	if (value < linear) {
+		return static_cast<std::size_t>(value);
 	}
-	if (by_time) { // Return by time percentile.
-		// Find largest and smallest time.
-		std::chrono::nanoseconds smallest = copy_timings.begin()->first;
-		std::chrono::nanoseconds largest  = copy_timings.rbegin()->first;
-		std::chrono::nanoseconds variance = largest - smallest;
-
-		for (auto kv : copy_timings) {
-			double_t kv_pct = double_t((kv.first - smallest).count()) / double_t(variance.count());
-			if (is_equal<double_t>(kv_pct, percentile, edge) || (kv_pct > percentile)) {
-				return std::chrono::nanoseconds(kv.first);
-			}
-		}
-	} else { // Return by call percentile.
-		if (percentile == 0.0) {
-			return copy_timings.begin()->first;
-		}
 
-		uint64_t accu_calls_now = 0;
-		for (auto kv : copy_timings) {
-			uint64_t accu_calls_last = accu_calls_now;
-			accu_calls_now += kv.second;
+	value = std::min<uint64_t>(value, (uint64_t(1) << histogram_limit) - 1);
 
-			double_t percentile_last = double_t(accu_calls_last) / double_t(calls);
-			double_t percentile_now  = double_t(accu_calls_now) / double_t(calls);
+	std::size_t msb = 0;
+	for (uint64_t v = value; v > 1; v >>= 1) {
+		msb++;
+	}
 
-			if (is_equal<double_t>(percentile, percentile_now, edge)
-				|| ((percentile_last < percentile) && (percentile_now > percentile))) {
-				return std::chrono::nanoseconds(kv.first);
-			}
-		}
+	// The top 'histogram_bits' bits select the bucket, the rest is discarded.
+	std::size_t shift = msb - histogram_bits + 1;
+	return (shift * histogram_half) + static_cast<std::size_t>(value >> shift);
+}
+
+uint64_t streamfx::util::profiler::bucket_value(std::size_t index)
+{
+	if (index < (histogram_half * 2)) {
+		return index;
 	}
 
-	return std::chrono::nanoseconds(-1);
+	std::size_t shift = (index / histogram_half) - 1;
+	return static_cast<uint64_t>(index - (shift * histogram_half)) << shift;
 }
 
 streamfx::util::profiler::instance::instance(std::shared_ptr<streamfx::util::profiler> parent)
@@ -154,6 +209,13 @@ streamfx::util::profiler::instance::~instance()
 	auto dur = end - _start;
 	if (_parent) {
 		_parent->track(dur);
+
+		if (_parent->_trace_name != std::numeric_limits<uint32_t>::max()) {
+			if (auto tracer = streamfx::util::tracer::current(); tracer) {
+				tracer->record(_parent->_trace_name, trace_category::SCOPE, std::chrono::steady_clock::now() - dur,
+							   std::chrono::duration_cast<std::chrono::nanoseconds>(dur));
+			}
+		}
 	}
 }
 
@@ -166,3 +228,188 @@ void streamfx::util::profiler::instance::reparent(std::shared_ptr<streamfx::util
 {
 	_parent = parent;
 }
+
+streamfx::util::profiler_registry::~profiler_registry()
+{
+	{
+		std::unique_lock<std::mutex> lock(_reporter_lock);
+		_reporter_stop = true;
+		_reporter_cv.notify_all();
+	}
+	if (_reporter.joinable()) {
+		_reporter.join();
+	}
+
+	// Don't lose whatever happened since the last report.
+	report();
+}
+
+streamfx::util::profiler_registry::profiler_registry()
+	: _profilers(), _values(), _profilers_lock(), _interval(ST_REPORT_INTERVAL), _json(false), _path(), _reporter(),
+	  _reporter_lock(), _reporter_cv(), _reporter_stop(false)
+{
+	if (auto config = streamfx::configuration::instance(); config) {
+		auto dataptr = config->get();
+
+		if (obs_data_has_user_value(dataptr.get(), ST_CFG_INTERVAL))
+			_interval = std::chrono::seconds(obs_data_get_int(dataptr.get(), ST_CFG_INTERVAL));
+		if (obs_data_has_user_value(dataptr.get(), ST_CFG_FORMAT))
+			_json = (std::string_view(obs_data_get_string(dataptr.get(), ST_CFG_FORMAT)) == "json");
+	}
+	_path = streamfx::config_file_path(_json ? "profiler.json" : "profiler.csv");
+
+	// An interval of zero only writes a report at shutdown.
+	if (_interval.count() > 0) {
+		_reporter = std::thread(std::bind(&streamfx::util::profiler_registry::reporter, this));
+	}
+}
+
+std::shared_ptr<streamfx::util::profiler> streamfx::util::profiler_registry::find(std::string_view name)
+{
+	std::unique_lock<std::mutex> lock(_profilers_lock);
+	if (auto kv = _profilers.find(name); kv != _profilers.end()) {
+		return kv->second;
+	}
+
+	auto entry = profiler::create(name);
+	_profilers.emplace(name, entry);
+	return entry;
+}
+
+void streamfx::util::profiler_registry::set_value(std::string_view name, int64_t value)
+{
+	std::unique_lock<std::mutex> lock(_profilers_lock);
+	if (auto kv = _values.find(name); kv != _values.end()) {
+		kv->second = value;
+	} else {
+		_values.emplace(name, value);
+	}
+}
+
+static std::string escape_json(std::string_view text)
+{
+	std::string result;
+	result.reserve(text.size());
+	for (char chr : text) {
+		if ((chr == '"') || (chr == '\\')) {
+			result.push_back('\\');
+		}
+		result.push_back(chr);
+	}
+	return result;
+}
+
+void streamfx::util::profiler_registry::report()
+try {
+	std::vector<std::pair<std::string, std::shared_ptr<profiler>>> profilers;
+	std::vector<std::pair<std::string, int64_t>>                   values;
+	{
+		std::unique_lock<std::mutex> lock(_profilers_lock);
+		profilers.assign(_profilers.begin(), _profilers.end());
+		values.assign(_values.begin(), _values.end());
+	}
+
+	// Roll the file over once it is too large.
+	std::error_code ec;
+	bool            exists = std::filesystem::exists(_path, ec);
+	if (exists && (std::filesystem::file_size(_path, ec) > ST_REPORT_SIZE_LIMIT)) {
+		auto previous = _path;
+		previous.replace_extension(std::string(".1") + _path.extension().string());
+		std::filesystem::rename(_path, previous, ec);
+		exists = false;
+	}
+	if (_path.has_parent_path()) {
+		std::filesystem::create_directories(_path.parent_path(), ec);
+	}
+
+	std::ofstream stream(_path, std::ios::out | std::ios::app);
+	if (!stream) {
+		D_LOG_WARNING("Failed to open '%s' for writing.", _path.u8string().c_str());
+		return;
+	}
+
+	auto timestamp =
+		std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	auto us = [](std::chrono::nanoseconds value) { return double_t(value.count()) / 1000.; };
+
+	if (_json) { // One JSON object per line.
+		stream << "{\"timestamp\":" << timestamp << ",\"scopes\":{";
+		bool first = true;
+		for (auto& kv : profilers) {
+			if (kv.second->count() == 0) {
+				continue;
+			}
+			stream << (first ? "" : ",") << "\"" << escape_json(kv.first) << "\":{\"count\":" << kv.second->count()
+				   << ",\"p50\":" << us(kv.second->percentile(0.50)) << ",\"p95\":" << us(kv.second->percentile(0.95))
+				   << ",\"p99\":" << us(kv.second->percentile(0.99)) << ",\"max\":" << us(kv.second->maximum())
+				   << "}";
+			first = false;
+		}
+		stream << "},\"values\":{";
+		first = true;
+		for (auto& kv : values) {
+			stream << (first ? "" : ",") << "\"" << escape_json(kv.first) << "\":" << kv.second;
+			first = false;
+		}
+		stream << "}}\n";
+	} else {
+		if (!exists) {
+			stream << "timestamp,scope,count,p50_us,p95_us,p99_us,max_us\n";
+		}
+		for (auto& kv : profilers) {
+			if (kv.second->count() == 0) {
+				continue;
+			}
+			stream << timestamp << "," << kv.first << "," << kv.second->count() << ","
+				   << us(kv.second->percentile(0.50)) << "," << us(kv.second->percentile(0.95)) << ","
+				   << us(kv.second->percentile(0.99)) << "," << us(kv.second->maximum()) << "\n";
+		}
+
+		// Values only have a count, and leave the timing columns empty.
+		for (auto& kv : values) {
+			stream << timestamp << "," << kv.first << "," << kv.second << ",,,,\n";
+		}
+	}
+} catch (std::exception const& ex) {
+	D_LOG_WARNING("Failed to write report: %s", ex.what());
+}
+
+void streamfx::util::profiler_registry::reporter()
+{
+	std::unique_lock<std::mutex> lock(_reporter_lock);
+	while (!_reporter_stop) {
+		if (_reporter_cv.wait_for(lock, _interval, [this]() { return _reporter_stop; })) {
+			break;
+		}
+
+		lock.unlock();
+		report();
+		lock.lock();
+	}
+}
+
+static std::shared_ptr<streamfx::util::profiler_registry> _registry;
+
+void streamfx::util::profiler_registry::initialize()
+{
+	if (!_registry)
+		_registry = std::make_shared<streamfx::util::profiler_registry>();
+}
+
+void streamfx::util::profiler_registry::finalize()
+{
+	_registry.reset();
+}
+
+std::shared_ptr<streamfx::util::profiler_registry> streamfx::util::profiler_registry::instance()
+{
+	return _registry;
+}
+
+std::shared_ptr<streamfx::util::profiler> streamfx::util::profiler_registry::get(std::string_view name)
+{
+	if (auto registry = instance(); registry) {
+		return registry->find(name);
+	}
+	return profiler::create(name);
+}
@@ -19,14 +19,43 @@
 
 #pragma once
 #include "common.hpp"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <filesystem>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
 
 namespace streamfx::util {
 	class profiler : public std::enable_shared_from_this<streamfx::util::profiler> {
-		std::map<std::chrono::nanoseconds, size_t> _timings;
-		std::mutex                                 _timings_lock;
+		/* Log-linear (HDR-style) histogram of timings in nanoseconds.
+		 *
+		 * Values below 2^7 are stored exactly, everything above in 64 buckets per power of two, which bounds the
+		 * relative error to 1/64. Recording is a handful of relaxed atomic increments on a per-thread shard, so
+		 * concurrent threads neither wait on each other nor fight over the same cache lines.
+		 */
+		static constexpr std::size_t histogram_bits    = 7;
+		static constexpr std::size_t histogram_half    = std::size_t(1) << (histogram_bits - 1);
+		static constexpr std::size_t histogram_limit   = 36; // 2^36 ns, slightly more than a minute.
+		static constexpr std::size_t histogram_buckets = (histogram_limit - histogram_bits + 2) * histogram_half;
+		static constexpr std::size_t histogram_shards  = 4;
+
+		struct alignas(64) shard {
+			std::atomic<uint64_t> count;
+			std::atomic<uint64_t> total;
+			std::atomic<uint64_t> buckets[histogram_buckets];
+		};
+
+		std::unique_ptr<shard[]> _shards;
+		std::atomic<uint64_t>    _minimum;
+		std::atomic<uint64_t>    _maximum;
+
+		// Name of the scope in traces, if it has one.
+		uint32_t _trace_name;
 
 		public:
 		class instance {
@@ -44,7 +73,7 @@ namespace streamfx::util {
 		};
 
 		private:
-		profiler();
+		profiler(std::string_view name = {});
 
 		public:
 		~profiler();
@@ -61,10 +90,67 @@ namespace streamfx::util {
 
 		std::chrono::nanoseconds percentile(double_t percentile, bool by_time = false);
 
+		std::chrono::nanoseconds maximum();
+
+		private:
+		static std::size_t bucket_index(uint64_t value);
+
+		static uint64_t bucket_value(std::size_t index);
+
 		public:
 		static std::shared_ptr<streamfx::util::profiler> create()
 		{
 			return std::shared_ptr<streamfx::util::profiler>{new profiler()};
 		}
+
+		static std::shared_ptr<streamfx::util::profiler> create(std::string_view name)
+		{
+			return std::shared_ptr<streamfx::util::profiler>{new profiler(name)};
+		}
+	};
+
+	/** Named profilers shared by the entire process.
+	 *
+	 * A background reporter periodically appends p50/p95/p99/max of every scope to a rolling CSV or JSON file in the
+	 * configuration directory, so that frame costs can be compared between builds and machines. Named values, like
+	 * the size of a cache, are written next to the scopes.
+	 */
+	class profiler_registry {
+		std::map<std::string, std::shared_ptr<profiler>, std::less<>> _profilers;
+		std::map<std::string, int64_t, std::less<>>                   _values;
+		std::mutex                                                    _profilers_lock;
+
+		std::chrono::seconds  _interval;
+		bool                  _json;
+		std::filesystem::path _path;
+
+		std::thread             _reporter;
+		std::mutex              _reporter_lock;
+		std::condition_variable _reporter_cv;
+		bool                    _reporter_stop;
+
+		public:
+		~profiler_registry();
+		profiler_registry();
+
+		/** Retrieve the profiler for a scope, creating it if necessary. */
+		std::shared_ptr<streamfx::util::profiler> find(std::string_view name);
+
+		/** Set a named value, like a counter or a size, which the next report contains as it is at that moment. */
+		void set_value(std::string_view name, int64_t value);
+
+		/** Write the current state of all scopes to disk. */
+		void report();
+
+		private:
+		void reporter();
+
+		public /* Singleton */:
+		static void                                               initialize();
+		static void                                               finalize();
+		static std::shared_ptr<streamfx::util::profiler_registry> instance();
+
+		/** Retrieve a named profiler, which is only registered if the registry exists. */
+		static std::shared_ptr<streamfx::util::profiler> get(std::string_view name);
 	};
 } // namespace streamfx::util
@@ -19,9 +19,16 @@
 
 #include "util-threadpool.hpp"
 #include "common.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <exception>
+#include <utility>
 #include "util/util-logging.hpp"
 
+#ifdef ENABLE_PROFILING
+#include "util/util-trace.hpp"
+#endif
+
 #ifdef _DEBUG
 #define ST_PREFIX "<%s> "
 #define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
@@ -36,119 +43,665 @@
 #define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
 #endif
 
-// Most Tasks likely wait for IO, so we can use that time for other tasks.
-#define ST_CONCURRENCY_MULTIPLIER 2
+// Bounds for the number of workers. Tasks may block on IO, so never go below the minimum, but also don't spawn a
+// thread storm on machines with a large amount of cores.
+#define ST_WORKERS_MINIMUM 2
+#define ST_WORKERS_MAXIMUM 32
+
+// Capacity of each workers local deque, the shared injection queue and the recycled task pool. Must be powers of two.
+#define ST_DEQUE_CAPACITY 256
+#define ST_QUEUE_CAPACITY 1024
+#define ST_POOL_CAPACITY 256
+
+// Bands of rows handed out by parallel_rows() should fit into the L2 cache of a single core, and images smaller than
+// the threshold are not worth waking up workers for.
+#define ST_PARALLEL_BAND_SIZE (256 * 1024)
+#define ST_PARALLEL_THRESHOLD (512 * 1024)
+
+// How many chunks each worker gets in parallel_for(), which evens out workers that start late or run slower.
+#define ST_PARALLEL_CHUNKS_PER_WORKER 4
+
+// Pool and worker index of the current thread, if it is a worker.
+static thread_local streamfx::util::threadpool* local_pool  = nullptr;
+static thread_local std::size_t                 local_index = 0;
+
+// Priority of the task the current thread is executing, which parallel_for() helpers inherit.
+static thread_local streamfx::util::threadpool_priority local_priority = streamfx::util::threadpool_priority::NORMAL;
+
+class streamfx::util::threadpool::queue {
+	struct cell {
+		std::atomic<std::size_t> sequence;
+		task*                    data;
+	};
+
+	std::unique_ptr<cell[]> _buffer;
+	std::size_t             _mask;
+
+	alignas(64) std::atomic<std::size_t> _enqueue_pos;
+	alignas(64) std::atomic<std::size_t> _dequeue_pos;
+
+	public:
+	queue(std::size_t capacity) : _buffer(new cell[capacity]), _mask(capacity - 1), _enqueue_pos(0), _dequeue_pos(0)
+	{
+		for (std::size_t idx = 0; idx < capacity; idx++) {
+			_buffer[idx].sequence.store(idx, std::memory_order_relaxed);
+			_buffer[idx].data = nullptr;
+		}
+	}
+
+	bool enqueue(task* data)
+	{
+		cell*       entry;
+		std::size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+		for (;;) {
+			entry            = &_buffer[pos & _mask];
+			std::size_t seq  = entry->sequence.load(std::memory_order_acquire);
+			intptr_t    diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false; // Full
+			} else {
+				pos = _enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		entry->data = data;
+		entry->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	task* dequeue()
+	{
+		cell*       entry;
+		std::size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+		for (;;) {
+			entry            = &_buffer[pos & _mask];
+			std::size_t seq  = entry->sequence.load(std::memory_order_acquire);
+			intptr_t    diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (diff == 0) {
+				if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return nullptr; // Empty
+			} else {
+				pos = _dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		task* data = entry->data;
+		entry->sequence.store(pos + _mask + 1, std::memory_order_release);
+		return data;
+	}
+};
+
+class streamfx::util::threadpool::deque {
+	std::unique_ptr<std::atomic<task*>[]> _buffer;
+	int64_t                               _capacity;
+
+	alignas(64) std::atomic<int64_t> _top;
+	alignas(64) std::atomic<int64_t> _bottom;
+
+	public:
+	deque(std::size_t capacity)
+		: _buffer(new std::atomic<task*>[capacity]), _capacity(static_cast<int64_t>(capacity)), _top(0), _bottom(0)
+	{}
+
+	// Only ever called by the owning worker.
+	bool push(task* data)
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed);
+		int64_t top    = _top.load(std::memory_order_acquire);
+		if ((bottom - top) >= _capacity) {
+			return false;
+		}
 
-streamfx::util::threadpool::threadpool()
-	: _workers(), _worker_stop(false), _worker_idx(0), _tasks(), _tasks_lock(), _tasks_cv()
+		_buffer[bottom & (_capacity - 1)].store(data, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Only ever called by the owning worker, takes from the bottom (LIFO).
+	task* pop()
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+		_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = _top.load(std::memory_order_relaxed);
+
+		if (top > bottom) { // Empty
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		task* data = _buffer[bottom & (_capacity - 1)].load(std::memory_order_relaxed);
+		if (top == bottom) { // Last element, race against thieves for it.
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				data = nullptr;
+			}
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return data;
+	}
+
+	// Called by any other worker, takes from the top (FIFO).
+	task* steal()
+	{
+		int64_t top = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = _bottom.load(std::memory_order_acquire);
+		if (top >= bottom) {
+			return nullptr;
+		}
+
+		task* data = _buffer[top & (_capacity - 1)].load(std::memory_order_relaxed);
+		if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return data;
+	}
+};
+
+streamfx::util::threadpool::threadpool(std::size_t workers)
+	: _workers(), _worker_stop(false), _worker_idx(0), _groups(), _tasks_sleepers(0), _tasks_lock(), _tasks_cv(),
+	  _task_pool()
 {
-	std::size_t concurrency = static_cast<size_t>(std::thread::hardware_concurrency() * ST_CONCURRENCY_MULTIPLIER);
-	for (std::size_t n = 0; n < concurrency; n++) {
-		_workers.emplace_back(std::bind(&streamfx::util::threadpool::work, this));
+	// Recycled tasks are only ever owned by the pool, so clean them up once the last reference disappears.
+	_task_pool = std::shared_ptr<queue>(new queue(ST_POOL_CAPACITY), [](queue* ptr) {
+		while (task* item = ptr->dequeue()) {
+			delete item;
+		}
+		delete ptr;
+	});
+
+	if (workers == 0) {
+		workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), ST_WORKERS_MINIMUM, ST_WORKERS_MAXIMUM);
+	}
+
+	for (auto& group : _groups) {
+		group.tasks = std::make_unique<queue>(ST_QUEUE_CAPACITY);
+		group.tasks_overflow_size.store(0);
+		group.pending.store(0);
+		group.active.store(0);
+		group.limit.store(workers);
+	}
+
+	// Workers steal from each other, so all of them must exist before the first thread starts.
+	_workers.reserve(workers);
+	for (std::size_t n = 0; n < workers; n++) {
+		auto entry = std::make_unique<worker>();
+		for (auto& tasks : entry->tasks) {
+			tasks = std::make_unique<deque>(ST_DEQUE_CAPACITY);
+		}
+		_workers.push_back(std::move(entry));
+	}
+
+	// Limits include all lower priority classes, so normal and background work together always leave one worker
+	// free for realtime work, and background work can never occupy more than a quarter of the pool.
+	limit(threadpool_priority::NORMAL, workers - 1);
+	limit(threadpool_priority::BACKGROUND, workers / 4);
+
+	for (std::size_t n = 0; n < workers; n++) {
+		_workers[n]->thread = std::thread(std::bind(&streamfx::util::threadpool::work, this, n));
 	}
 }
 
 streamfx::util::threadpool::~threadpool()
 {
 	_worker_stop = true;
-	_tasks_cv.notify_all();
-	for (auto& thread : _workers) {
+	{
+		std::unique_lock<std::mutex> lock(_tasks_lock);
 		_tasks_cv.notify_all();
-		if (thread.joinable()) {
-			thread.join();
+	}
+	for (auto& entry : _workers) {
+		if (entry->thread.joinable()) {
+			entry->thread.join();
+		}
+	}
+
+	// Release everything that never got to run, so that anyone waiting on it wakes up.
+	for (std::size_t priority = 0; priority < threadpool_priority_count; priority++) {
+		for (std::size_t idx = 0; idx < _workers.size(); idx++) {
+			while (task* item = dequeue(idx, priority)) {
+				std::shared_ptr<task> local_work = std::move(item->_queued);
+				finish(local_work, true);
+			}
 		}
 	}
 }
 
-std::shared_ptr<::streamfx::util::threadpool::task> streamfx::util::threadpool::push(threadpool_callback_t fn,
-																					 threadpool_data_t     data)
+std::shared_ptr<::streamfx::util::threadpool::task>
+	streamfx::util::threadpool::push(threadpool_callback_t fn, threadpool_data_t data, threadpool_priority priority,
+									 std::shared_ptr<cancellation_token> token, threadpool_deadline_t deadline)
 {
-	auto task = std::make_shared<streamfx::util::threadpool::task>(fn, data);
+	auto task = allocate(fn, data, priority, token, deadline);
+	enqueue(task);
+	return task;
+}
 
-	// Append the task to the queue.
-	std::unique_lock<std::mutex> lock(_tasks_lock);
-	_tasks.emplace_back(task);
-	_tasks_cv.notify_one();
+std::shared_ptr<::streamfx::util::threadpool::task>
+	streamfx::util::threadpool::then(std::shared_ptr<::streamfx::util::threadpool::task> previous,
+									 threadpool_callback_t fn, threadpool_data_t data, threadpool_priority priority,
+									 std::shared_ptr<cancellation_token> token, threadpool_deadline_t deadline)
+{
+	return when_all({previous}, fn, data, priority, token, deadline);
+}
+
+std::shared_ptr<::streamfx::util::threadpool::task>
+	streamfx::util::threadpool::when_all(std::vector<std::shared_ptr<::streamfx::util::threadpool::task>> previous,
+										 threadpool_callback_t fn, threadpool_data_t data,
+										 threadpool_priority priority, std::shared_ptr<cancellation_token> token,
+										 threadpool_deadline_t deadline)
+{
+	auto task = allocate(fn, data, priority, token, deadline);
+
+	// Hold one extra dependency while registering, so that the task can't be queued early.
+	task->_dependencies.store(previous.size() + 1);
+	for (auto& entry : previous) {
+		if (entry) {
+			std::unique_lock<std::mutex> lock(entry->_mutex);
+			if (!entry->_is_dead) {
+				entry->_continuations.push_back(task);
+				continue;
+			}
+		}
+
+		// Already finished (or nothing to wait on).
+		resolve(task);
+	}
+	resolve(task);
 
 	return task;
 }
 
+namespace {
+	struct parallel_state {
+		streamfx::util::threadpool_range_callback_t callback;
+		std::size_t                                 begin;
+		std::size_t                                 count;
+		std::size_t                                 chunks;
+
+		std::atomic<std::size_t> next;
+		std::atomic<std::size_t> done;
+
+		std::mutex              lock;
+		std::condition_variable cv;
+		std::exception_ptr      error;
+	};
+
+	void parallel_work(parallel_state& state)
+	{
+		for (std::size_t idx = state.next.fetch_add(1); idx < state.chunks; idx = state.next.fetch_add(1)) {
+			// Chunks are contiguous and handed out in order, so neighbouring workers never share cache lines.
+			std::size_t begin = state.begin + (idx * state.count) / state.chunks;
+			std::size_t end   = state.begin + ((idx + 1) * state.count) / state.chunks;
+
+			try {
+				state.callback(begin, end);
+			} catch (...) {
+				std::unique_lock<std::mutex> lock(state.lock);
+				if (!state.error) {
+					state.error = std::current_exception();
+				}
+			}
+
+			if ((state.done.fetch_add(1) + 1) == state.chunks) {
+				std::unique_lock<std::mutex> lock(state.lock);
+				state.cv.notify_all();
+			}
+		}
+	}
+} // namespace
+
+void streamfx::util::threadpool::parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+											  threadpool_range_callback_t fn)
+{
+	if (end <= begin) {
+		return;
+	}
+
+	std::size_t count  = end - begin;
+	std::size_t chunks = (count + std::max<std::size_t>(grain, 1) - 1) / std::max<std::size_t>(grain, 1);
+	chunks             = std::clamp<std::size_t>(chunks, 1, (_workers.size() + 1) * ST_PARALLEL_CHUNKS_PER_WORKER);
+	if (chunks == 1) {
+		fn(begin, end);
+		return;
+	}
+
+	auto state      = std::make_shared<parallel_state>();
+	state->callback = std::move(fn);
+	state->begin    = begin;
+	state->count    = count;
+	state->chunks   = chunks;
+	state->next.store(0);
+	state->done.store(0);
+
+	// Helpers which start after everything was done simply find nothing left to do. They run at the priority of the
+	// calling task, so background work can't crowd out realtime work through parallel_for().
+	std::size_t helpers = std::min<std::size_t>(chunks - 1, _workers.size());
+	for (std::size_t n = 0; n < helpers; n++) {
+		push([state](threadpool_data_t) { parallel_work(*state); }, nullptr, local_priority);
+	}
+	parallel_work(*state);
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(state->lock);
+		state->cv.wait(lock, [&state]() { return state->done.load() == state->chunks; });
+		std::swap(error, state->error);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void streamfx::util::threadpool::parallel_rows(std::size_t rows, std::size_t row_size, threadpool_range_callback_t fn)
+{
+	row_size = std::max<std::size_t>(row_size, 1);
+	if ((rows * row_size) < ST_PARALLEL_THRESHOLD) {
+		fn(0, rows);
+		return;
+	}
+
+	parallel_for(0, rows, std::max<std::size_t>(ST_PARALLEL_BAND_SIZE / row_size, 1), std::move(fn));
+}
+
 void streamfx::util::threadpool::pop(std::shared_ptr<::streamfx::util::threadpool::task> work)
 {
 	if (work) {
-		{
-			std::unique_lock<std::mutex> lock(work->_mutex);
-			work->_is_dead = true;
+		finish(work, true);
+	}
+}
+
+void streamfx::util::threadpool::limit(threadpool_priority priority, std::size_t workers)
+{
+	workers = std::clamp<std::size_t>(workers, 1, std::max<std::size_t>(_workers.size(), 1));
+	_groups[static_cast<std::size_t>(priority)].limit.store(workers);
+
+	// Raising a limit may make queued work runnable.
+	std::unique_lock<std::mutex> lock(_tasks_lock);
+	_tasks_cv.notify_all();
+}
+
+std::size_t streamfx::util::threadpool::limit(threadpool_priority priority)
+{
+	return _groups[static_cast<std::size_t>(priority)].limit.load();
+}
+
+std::size_t streamfx::util::threadpool::size()
+{
+	return _workers.size();
+}
+
+std::shared_ptr<::streamfx::util::threadpool::task>
+	streamfx::util::threadpool::allocate(threadpool_callback_t fn, threadpool_data_t data, threadpool_priority priority,
+										 std::shared_ptr<cancellation_token> token, threadpool_deadline_t deadline)
+{
+	task* ptr = _task_pool->dequeue();
+	if (ptr) {
+		ptr->_callback = std::move(fn);
+		ptr->_data     = std::move(data);
+		ptr->_priority = priority;
+		ptr->_is_dead.store(false);
+		ptr->_is_cancelled.store(false);
+		ptr->_dependencies.store(0);
+	} else {
+		ptr = new task(std::move(fn), std::move(data), priority);
+	}
+	ptr->_token    = std::move(token);
+	ptr->_deadline = deadline;
+
+	// Instead of freeing the task, hand it back to the pool. The pool may outlive us if someone holds on to a task.
+	std::weak_ptr<queue> pool = _task_pool;
+	return std::shared_ptr<task>(ptr, [pool](task* ptr) {
+		ptr->_callback = nullptr;
+		ptr->_data.reset();
+		ptr->_token.reset();
+		ptr->_continuations.clear();
+		if (auto pool_ = pool.lock(); !pool_ || !pool_->enqueue(ptr)) {
+			delete ptr;
 		}
-		work->_is_complete.notify_all();
+	});
+}
+
+void streamfx::util::threadpool::finish(std::shared_ptr<::streamfx::util::threadpool::task> work, bool cancelled)
+{
+	std::vector<std::shared_ptr<task>> continuations;
+	{
+		std::unique_lock<std::mutex> lock(work->_mutex);
+		if (work->_is_dead) { // Someone else already finished it.
+			return;
+		}
+		work->_is_cancelled.store(cancelled);
+		work->_is_dead.store(true);
+		continuations.swap(work->_continuations);
+	}
+	work->_is_complete.notify_all();
+
+	for (auto& continuation : continuations) {
+		resolve(continuation);
 	}
 }
 
-void streamfx::util::threadpool::work()
+void streamfx::util::threadpool::resolve(std::shared_ptr<::streamfx::util::threadpool::task> work)
 {
-	std::shared_ptr<streamfx::util::threadpool::task> local_work{};
-	uint32_t                                          local_number = _worker_idx.fetch_add(1);
+	if (work->_dependencies.fetch_sub(1) == 1) {
+		enqueue(work);
+	}
+}
 
-	while (!_worker_stop) {
-		// Wait for more work, or immediately continue if there is still work to do.
+void streamfx::util::threadpool::enqueue(std::shared_ptr<::streamfx::util::threadpool::task> work)
+{
+	// Nobody is left to run it, so drop it right away.
+	if (_worker_stop) {
+		finish(work, true);
+		return;
+	}
+
+	task*       ptr      = work.get();
+	std::size_t priority = static_cast<std::size_t>(ptr->_priority);
+	group&      group    = _groups[priority];
+	ptr->_queued         = std::move(work);
+
+	// Counted before it becomes visible, so that a worker taking it right away can never drive the count below zero.
+	group.pending.fetch_add(1);
+
+	// Workers queue follow-up work locally, everyone else goes through the shared queue.
+	bool queued = (local_pool == this) && _workers[local_index]->tasks[priority]->push(ptr);
+	if (!queued) {
+		queued = group.tasks->enqueue(ptr);
+	}
+	if (!queued) {
+		std::unique_lock<std::mutex> lock(group.tasks_overflow_lock);
+		group.tasks_overflow.push_back(ptr);
+		group.tasks_overflow_size.fetch_add(1);
+	}
+
+	// Only touch the mutex if there is actually someone to wake up.
+	if (_tasks_sleepers.load() > 0) {
 		{
-			// Lock the tasks mutex to check for work.
 			std::unique_lock<std::mutex> lock(_tasks_lock);
+		}
+		_tasks_cv.notify_one();
+	}
+}
 
-			// If there are currently no tasks queued, wait on the condition variable.
-			// This temporarily unlocks the mutex until it is woken up.
-			if (_tasks.size() == 0) {
-				_tasks_cv.wait(lock, [this]() { return _worker_stop || _tasks.size() > 0; });
-			}
+streamfx::util::threadpool::task* streamfx::util::threadpool::dequeue(std::size_t index, std::size_t priority)
+{
+	group& group = _groups[priority];
 
-			// If there is either no tasks or we were asked to stop, skip everything.
-			if (_worker_stop || (_tasks.size() == 0)) {
-				continue;
-			}
+	// 1. Our own work, newest first as it is most likely still in cache.
+	if (task* ptr = _workers[index]->tasks[priority]->pop(); ptr) {
+		return ptr;
+	}
+
+	// 2. Work pushed from outside of the pool.
+	if (task* ptr = group.tasks->dequeue(); ptr) {
+		return ptr;
+	}
+	if (group.tasks_overflow_size.load() > 0) {
+		std::unique_lock<std::mutex> lock(group.tasks_overflow_lock);
+		if (group.tasks_overflow.size() > 0) {
+			task* ptr = group.tasks_overflow.front();
+			group.tasks_overflow.pop_front();
+			group.tasks_overflow_size.fetch_sub(1);
+			return ptr;
+		}
+	}
 
-			// Grab the latest task and immediately remove it from the queue.
-			local_work = _tasks.front();
-			_tasks.pop_front();
+	// 3. Steal the oldest work from other workers.
+	std::size_t workers = _workers.size();
+	for (std::size_t n = 1; n < workers; n++) {
+		if (task* ptr = _workers[(index + n) % workers]->tasks[priority]->steal(); ptr) {
+			return ptr;
 		}
+	}
 
-		// If the task was killed, skip everything again.
-		if (local_work->_is_dead.load()) {
+	return nullptr;
+}
+
+bool streamfx::util::threadpool::is_allowed(std::size_t priority, std::size_t extra)
+{
+	// Limits include all lower priority classes, so check this class and every class above it.
+	std::size_t active = extra;
+	for (std::size_t idx = threadpool_priority_count; idx > 0; idx--) {
+		active += _groups[idx - 1].active.load();
+		if ((idx - 1) <= priority) {
+			if (active > _groups[idx - 1].limit.load()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+streamfx::util::threadpool::task* streamfx::util::threadpool::acquire(std::size_t index)
+{
+	for (std::size_t priority = 0; priority < threadpool_priority_count; priority++) {
+		group& group = _groups[priority];
+		if (group.pending.load() == 0) {
 			continue;
 		}
 
+		// Reserve a slot first, then verify that no limit was exceeded by doing so.
+		group.active.fetch_add(1);
+		if (is_allowed(priority, 0)) {
+			if (task* ptr = dequeue(index, priority); ptr) {
+				group.pending.fetch_sub(1);
+				return ptr;
+			}
+		}
+		group.active.fetch_sub(1);
+	}
+
+	return nullptr;
+}
+
+bool streamfx::util::threadpool::is_runnable()
+{
+	if (_worker_stop) {
+		return true;
+	}
+
+	for (std::size_t priority = 0; priority < threadpool_priority_count; priority++) {
+		if ((_groups[priority].pending.load() > 0) && is_allowed(priority, 1)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void streamfx::util::threadpool::execute(std::size_t index, task* work)
+{
+	// Take over the reference the queue held.
+	std::shared_ptr<streamfx::util::threadpool::task> local_work = std::move(work->_queued);
+	group&                                            group      = _groups[static_cast<std::size_t>(work->_priority)];
+
+	// Skip work that was killed, or is no longer wanted.
+	if (local_work->is_cancelled()) {
+		finish(local_work, true);
+	} else {
 		// Try to execute work, but don't crash on catchable exceptions.
 		if (local_work->_callback) {
+			auto previous_priority = std::exchange(local_priority, local_work->_priority);
+#ifdef ENABLE_PROFILING
+			static const uint32_t trace_names[threadpool_priority_count] = {
+				::streamfx::util::tracer::intern("threadpool::realtime"),
+				::streamfx::util::tracer::intern("threadpool::normal"),
+				::streamfx::util::tracer::intern("threadpool::background"),
+			};
+			::streamfx::util::tracer::scope trace(trace_names[static_cast<std::size_t>(local_work->_priority)],
+												  ::streamfx::util::trace_category::TASK);
+#endif
 			try {
 				local_work->_callback(local_work->_data);
 			} catch (std::exception const& ex) {
 				D_LOG_WARNING("Worker %" PRIx32 " caught exception from task (%" PRIxPTR ", %" PRIxPTR
 							  ") with message: %s",
-							  local_number, reinterpret_cast<ptrdiff_t>(local_work->_callback.target<void>()),
+							  static_cast<uint32_t>(index),
+							  reinterpret_cast<ptrdiff_t>(local_work->_callback.target<void>()),
 							  reinterpret_cast<ptrdiff_t>(local_work->_data.get()), ex.what());
 			} catch (...) {
-				D_LOG_WARNING("Worker %" PRIx32 " caught exception of unknown type from task (%" PRIxPTR ", %" PRIxPTR
-							  ").",
-							  local_number, reinterpret_cast<ptrdiff_t>(local_work->_callback.target<void>()),
+				D_LOG_WARNING("Worker %" PRIx32 " caught exception of unknown type from task (%" PRIxPTR
+							  ", %" PRIxPTR ").",
+							  static_cast<uint32_t>(index),
+							  reinterpret_cast<ptrdiff_t>(local_work->_callback.target<void>()),
 							  reinterpret_cast<ptrdiff_t>(local_work->_data.get()));
 			}
-			{
-				std::unique_lock<std::mutex> lock(local_work->_mutex);
-				local_work->_is_dead.store(true);
-			}
-			local_work->_is_complete.notify_all();
+			local_priority = previous_priority;
+		}
+		finish(local_work, false);
+	}
+
+	// Free up the slot, which may allow capped work to run.
+	group.active.fetch_sub(1);
+	if (_tasks_sleepers.load() > 0) {
+		{
+			std::unique_lock<std::mutex> lock(_tasks_lock);
 		}
+		_tasks_cv.notify_one();
+	}
+}
+
+void streamfx::util::threadpool::work(std::size_t index)
+{
+	local_pool  = this;
+	local_index = index;
+	_worker_idx.fetch_add(1);
+
+#ifdef ENABLE_PROFILING
+	::streamfx::util::tracer::name_thread("threadpool::worker " + std::to_string(index));
+#endif
 
-		// Remove our reference to the work unit.
-		local_work.reset();
+	while (!_worker_stop) {
+		if (task* ptr = acquire(index); ptr) {
+			execute(index, ptr);
+			continue;
+		}
+
+		// Nothing we are allowed to do, so sleep until someone pushes new work or a slot frees up.
+		std::unique_lock<std::mutex> lock(_tasks_lock);
+		_tasks_sleepers.fetch_add(1);
+		_tasks_cv.wait(lock, [this]() { return is_runnable(); });
+		_tasks_sleepers.fetch_sub(1);
 	}
 
 	_worker_idx.fetch_sub(1);
+	local_pool = nullptr;
 }
 
-streamfx::util::threadpool::task::task() = default;
+streamfx::util::threadpool::task::task()
+	: _mutex(), _is_complete(), _is_dead(false), _is_cancelled(false), _callback(), _data(),
+	  _priority(threadpool_priority::NORMAL), _token(), _deadline(threadpool_deadline_t::max()), _continuations(),
+	  _dependencies(0), _queued()
+{}
 
-streamfx::util::threadpool::task::task(threadpool_callback_t fn, threadpool_data_t dt)
-	: _mutex(), _is_complete(), _is_dead(false), _callback(fn), _data(dt)
+streamfx::util::threadpool::task::task(threadpool_callback_t fn, threadpool_data_t dt, threadpool_priority priority)
+	: _mutex(), _is_complete(), _is_dead(false), _is_cancelled(false), _callback(fn), _data(dt), _priority(priority),
+	  _token(), _deadline(threadpool_deadline_t::max()), _continuations(), _dependencies(0), _queued()
 {}
 
 void streamfx::util::threadpool::task::await_completion()
@@ -158,3 +711,29 @@ void streamfx::util::threadpool::task::await_completion()
 		_is_complete.wait(lock, [this]() { return this->_is_dead.load(); });
 	}
 }
+
+bool streamfx::util::threadpool::task::is_cancelled()
+{
+	if (_is_dead) {
+		return _is_cancelled;
+	}
+	if (_token && _token->is_cancelled()) {
+		return true;
+	}
+	if ((_deadline != threadpool_deadline_t::max()) && (std::chrono::steady_clock::now() > _deadline)) {
+		return true;
+	}
+	return false;
+}
+
+streamfx::util::threadpool::cancellation_token::cancellation_token() : _cancelled(false) {}
+
+void streamfx::util::threadpool::cancellation_token::cancel()
+{
+	_cancelled.store(true);
+}
+
+bool streamfx::util::threadpool::cancellation_token::is_cancelled()
+{
+	return _cancelled.load();
+}
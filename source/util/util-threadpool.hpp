@@ -19,55 +19,201 @@
 
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <thread>
+#include <vector>
 
 namespace streamfx::util {
-	typedef std::shared_ptr<void>                  threadpool_data_t;
-	typedef std::function<void(threadpool_data_t)> threadpool_callback_t;
+	typedef std::shared_ptr<void>                         threadpool_data_t;
+	typedef std::function<void(threadpool_data_t)>        threadpool_callback_t;
+	typedef std::chrono::steady_clock::time_point         threadpool_deadline_t;
+	typedef std::function<void(std::size_t, std::size_t)> threadpool_range_callback_t;
+
+	enum class threadpool_priority : uint8_t {
+		REALTIME,   // Latency critical work, like audio or frame delivery.
+		NORMAL,     // Everything else.
+		BACKGROUND, // Slow work which may take seconds, like loading models or network requests.
+	};
+	constexpr std::size_t threadpool_priority_count = 3;
 
 	class threadpool {
 		public:
+		/** Cooperative cancellation, shareable between any number of tasks.
+		 *
+		 * Tasks which have not started yet are dropped once the token is cancelled, while running tasks may poll it.
+		 */
+		class cancellation_token {
+			std::atomic<bool> _cancelled;
+
+			public:
+			cancellation_token();
+
+			void cancel();
+
+			bool is_cancelled();
+		};
+
 		class task {
 			protected:
 			std::mutex              _mutex;
 			std::condition_variable _is_complete;
 			std::atomic<bool>       _is_dead;
+			std::atomic<bool>       _is_cancelled;
 			threadpool_callback_t   _callback;
 			threadpool_data_t       _data;
+			threadpool_priority     _priority;
+
+			std::shared_ptr<cancellation_token> _token;
+			threadpool_deadline_t               _deadline;
+
+			// Continuations waiting on this task, and the number of tasks this one is still waiting on.
+			std::vector<std::shared_ptr<task>> _continuations;
+			std::atomic<std::size_t>           _dependencies;
+
+			// Reference held while the task is queued, released by whichever worker dequeues it.
+			std::shared_ptr<task> _queued;
 
 			public:
 			task();
-			task(threadpool_callback_t callback_function, threadpool_data_t data);
+			task(threadpool_callback_t callback_function, threadpool_data_t data,
+				 threadpool_priority priority = threadpool_priority::NORMAL);
 
 			void await_completion();
 
+			/** Check if the task was cancelled, either directly, through its token or by missing its deadline. */
+			bool is_cancelled();
+
 			friend class streamfx::util::threadpool;
 		};
 
 		private:
-		std::list<std::thread>                                         _workers;
-		std::atomic<bool>                                              _worker_stop;
-		std::atomic<uint32_t>                                          _worker_idx;
-		std::list<std::shared_ptr<::streamfx::util::threadpool::task>> _tasks;
-		std::mutex                                                     _tasks_lock;
-		std::condition_variable                                        _tasks_cv;
+		// Bounded multi-producer/multi-consumer queue (D. Vyukov), used for injection and task recycling.
+		class queue;
+
+		// Single-owner work-stealing deque (Chase-Lev), one per worker.
+		class deque;
+
+		struct worker {
+			std::thread            thread;
+			std::unique_ptr<deque> tasks[threadpool_priority_count];
+		};
+
+		// Everything needed to schedule a single priority class.
+		struct group {
+			// Tasks pushed from outside of the pool.
+			std::unique_ptr<queue>   tasks;
+			std::list<task*>         tasks_overflow;
+			std::mutex               tasks_overflow_lock;
+			std::atomic<std::size_t> tasks_overflow_size;
+
+			std::atomic<std::size_t> pending; // Queued, but not yet picked up.
+			std::atomic<std::size_t> active;  // Currently being executed.
+			std::atomic<std::size_t> limit;   // Maximum number of workers allowed to execute at once.
+		};
+
+		std::vector<std::unique_ptr<worker>> _workers;
+		std::atomic<bool>                    _worker_stop;
+		std::atomic<uint32_t>                _worker_idx;
+
+		group _groups[threadpool_priority_count];
+
+		// Idle workers wait here until new tasks are pushed, or a capped class frees up a slot.
+		std::atomic<std::size_t> _tasks_sleepers;
+		std::mutex               _tasks_lock;
+		std::condition_variable  _tasks_cv;
+
+		// Recycled task objects, shared with the deleter of every handed out task.
+		std::shared_ptr<queue> _task_pool;
 
 		public:
-		threadpool();
+		/** Create a new thread pool.
+		 *
+		 * @param workers Number of worker threads, or 0 to use the hardware concurrency (bounded).
+		 */
+		threadpool(std::size_t workers = 0);
 		~threadpool();
 
-		std::shared_ptr<::streamfx::util::threadpool::task> push(threadpool_callback_t callback_function,
-																 threadpool_data_t     data);
+		std::shared_ptr<::streamfx::util::threadpool::task>
+			push(threadpool_callback_t callback_function, threadpool_data_t data,
+				 threadpool_priority                 priority = threadpool_priority::NORMAL,
+				 std::shared_ptr<cancellation_token> token    = nullptr,
+				 threadpool_deadline_t               deadline = threadpool_deadline_t::max());
+
+		/** Queue a task once the given task has finished.
+		 *
+		 * Continuations run regardless of whether the previous task completed or was cancelled. Share a
+		 * cancellation_token between them to cancel an entire chain.
+		 */
+		std::shared_ptr<::streamfx::util::threadpool::task>
+			then(std::shared_ptr<::streamfx::util::threadpool::task> previous, threadpool_callback_t callback_function,
+				 threadpool_data_t data, threadpool_priority priority = threadpool_priority::NORMAL,
+				 std::shared_ptr<cancellation_token> token    = nullptr,
+				 threadpool_deadline_t               deadline = threadpool_deadline_t::max());
+
+		/** Queue a task once all of the given tasks have finished. */
+		std::shared_ptr<::streamfx::util::threadpool::task>
+			when_all(std::vector<std::shared_ptr<::streamfx::util::threadpool::task>> previous,
+					 threadpool_callback_t callback_function, threadpool_data_t data,
+					 threadpool_priority                 priority = threadpool_priority::NORMAL,
+					 std::shared_ptr<cancellation_token> token    = nullptr,
+					 threadpool_deadline_t               deadline = threadpool_deadline_t::max());
 
 		void pop(std::shared_ptr<::streamfx::util::threadpool::task> work);
 
+		/** Split [begin, end) into contiguous chunks of at least 'grain' items and process them on the pool.
+		 *
+		 * Blocks until every chunk was processed. The calling thread processes chunks too, so this is safe to call from
+		 * a worker and never waits on workers that are busy elsewhere. Exceptions are rethrown in the calling thread.
+		 * Chunks are handed to workers at the priority of the calling task, or NORMAL outside of the pool.
+		 */
+		void parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+						  threadpool_range_callback_t callback_function);
+
+		/** Split 'rows' rows of 'row_size' bytes each into bands which fit in cache, and process them on the pool.
+		 *
+		 * Small images are processed on the calling thread, as waking up workers would cost more than it saves.
+		 */
+		void parallel_rows(std::size_t rows, std::size_t row_size, threadpool_range_callback_t callback_function);
+
+		/** Limit how many workers may execute tasks of a priority class at the same time.
+		 *
+		 * Limits are clamped to [1, size()], so that every class can always make progress.
+		 */
+		void limit(threadpool_priority priority, std::size_t workers);
+
+		std::size_t limit(threadpool_priority priority);
+
+		std::size_t size();
+
 		private:
-		void work();
+		std::shared_ptr<::streamfx::util::threadpool::task>
+			allocate(threadpool_callback_t callback_function, threadpool_data_t data, threadpool_priority priority,
+					 std::shared_ptr<cancellation_token> token, threadpool_deadline_t deadline);
+
+		void finish(std::shared_ptr<::streamfx::util::threadpool::task> work, bool cancelled);
+
+		void resolve(std::shared_ptr<::streamfx::util::threadpool::task> work);
+
+		void enqueue(std::shared_ptr<::streamfx::util::threadpool::task> work);
+
+		task* dequeue(std::size_t index, std::size_t priority);
+
+		task* acquire(std::size_t index);
+
+		bool is_allowed(std::size_t priority, std::size_t extra);
+
+		bool is_runnable();
+
+		void execute(std::size_t index, task* work);
+
+		void work(std::size_t index);
 	};
 } // namespace streamfx::util
@@ -0,0 +1,374 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "util-trace.hpp"
+#include <array>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <shared_mutex>
+#include <unordered_map>
+#include "configuration.hpp"
+#include "util/util-logging.hpp"
+
+#ifdef _DEBUG
+#define ST_PREFIX "<%s> "
+#define D_LOG_ERROR(x, ...) P_LOG_ERROR(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_WARNING(x, ...) P_LOG_WARN(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_INFO(x, ...) P_LOG_INFO(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#define D_LOG_DEBUG(x, ...) P_LOG_DEBUG(ST_PREFIX##x, __FUNCTION_SIG__, __VA_ARGS__)
+#else
+#define ST_PREFIX "<util::tracer> "
+#define D_LOG_ERROR(...) P_LOG_ERROR(ST_PREFIX __VA_ARGS__)
+#define D_LOG_WARNING(...) P_LOG_WARN(ST_PREFIX __VA_ARGS__)
+#define D_LOG_INFO(...) P_LOG_INFO(ST_PREFIX __VA_ARGS__)
+#define D_LOG_DEBUG(...) P_LOG_DEBUG(ST_PREFIX __VA_ARGS__)
+#endif
+
+// Configuration
+#define ST_CFG_TRACE "profiler.trace"
+
+// Events kept per thread, 24 bytes each.
+#define ST_TRACE_EVENTS 65536
+
+static const char* category_names[] = {
+	"scope",
+	"marker",
+	"gpu",
+	"task",
+	"wait",
+};
+
+static std::atomic<uint64_t> _tracer_ids{1};
+
+// Scopes are created far too often to touch a reference count each time, see tracer::current().
+static std::shared_ptr<streamfx::util::tracer> _tracer;
+static std::atomic<streamfx::util::tracer*>    _tracer_raw{nullptr};
+
+class streamfx::util::tracer::buffer {
+	public:
+	// Individually atomic, so that reading while the owner writes is well defined. Torn events are detected and
+	// dropped by the reader through 'head'.
+	struct event {
+		std::atomic<uint64_t> name; // Category in the upper, name in the lower 32 bits.
+		std::atomic<uint64_t> start;
+		std::atomic<uint64_t> duration;
+	};
+
+	std::unique_ptr<event[]> events;
+	std::atomic<uint64_t>    head;
+	std::atomic<uint64_t>    origin; // Where the current owner started, older events belong to a thread that exited.
+	std::size_t              index;
+	std::string              name;
+
+	public:
+	buffer(std::size_t index)
+		: events(std::make_unique<event[]>(ST_TRACE_EVENTS)), head(0), origin(0), index(index), name()
+	{}
+
+	// Give the buffer of a thread that exited back to the tracer it came from, if that is still around.
+	static void release(uint64_t id, buffer* ptr)
+	{
+		if (auto self = tracer::instance(); self && (self->_id == id)) {
+			std::unique_lock<std::mutex> lock(self->_buffers_lock);
+			self->_buffers_free.push_back(ptr);
+		}
+	}
+
+	void push(uint64_t name, uint64_t start, uint64_t duration)
+	{
+		uint64_t position = head.load(std::memory_order_relaxed);
+
+		// Anyone who sees part of this event must also see the head from before it, see read().
+		std::atomic_thread_fence(std::memory_order_release);
+		auto& ev = events[position % ST_TRACE_EVENTS];
+		ev.name.store(name, std::memory_order_relaxed);
+		ev.start.store(start, std::memory_order_relaxed);
+		ev.duration.store(duration, std::memory_order_relaxed);
+		head.store(position + 1, std::memory_order_release);
+	}
+
+	void read(std::vector<std::array<uint64_t, 3>>& output)
+	{
+		uint64_t end   = head.load(std::memory_order_acquire);
+		uint64_t begin = std::max((end > ST_TRACE_EVENTS) ? (end - ST_TRACE_EVENTS) : 0,
+								  std::min(origin.load(std::memory_order_relaxed), end));
+
+		std::size_t offset = output.size();
+		for (uint64_t position = begin; position < end; position++) {
+			auto& ev = events[position % ST_TRACE_EVENTS];
+			output.push_back({ev.name.load(std::memory_order_relaxed), ev.start.load(std::memory_order_relaxed),
+							  ev.duration.load(std::memory_order_relaxed)});
+		}
+
+		// Drop everything the owner may have overwritten while we were reading.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t now   = head.load(std::memory_order_relaxed);
+		uint64_t valid = (now >= ST_TRACE_EVENTS) ? (now - ST_TRACE_EVENTS + 1) : 0;
+		if (valid > begin) {
+			output.erase(output.begin() + static_cast<std::ptrdiff_t>(offset),
+						 output.begin() + static_cast<std::ptrdiff_t>(offset + std::min(valid - begin, end - begin)));
+		}
+	}
+};
+
+// Names outlive any tracer, so that ids can be cached in static variables.
+struct name_table {
+	std::shared_mutex                              lock;
+	std::deque<std::string>                        names;
+	std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+static name_table& names()
+{
+	static name_table table;
+	return table;
+}
+
+// Per-thread state, tied to the tracer instance which created the buffer.
+struct local_state {
+	uint64_t                        tracer = 0;
+	streamfx::util::tracer::buffer* buffer = nullptr;
+	std::string                     name;
+
+	~local_state()
+	{
+		if (buffer) {
+			streamfx::util::tracer::buffer::release(tracer, buffer);
+		}
+	}
+};
+
+static thread_local local_state _local;
+
+static std::string escape_json(std::string_view text)
+{
+	std::string result;
+	result.reserve(text.size());
+	for (char chr : text) {
+		if ((chr == '"') || (chr == '\\')) {
+			result.push_back('\\');
+			result.push_back(chr);
+		} else if (static_cast<unsigned char>(chr) < 0x20) {
+			result.push_back(' ');
+		} else {
+			result.push_back(chr);
+		}
+	}
+	return result;
+}
+
+streamfx::util::tracer::scope::scope(uint32_t name, trace_category category)
+	: _parent(tracer::current()), _name(name), _category(category), _start()
+{
+	if (_parent) {
+		_start = std::chrono::steady_clock::now();
+	}
+}
+
+streamfx::util::tracer::scope::~scope()
+{
+	if (_parent) {
+		_parent->record(_name, _category, _start, std::chrono::steady_clock::now() - _start);
+	}
+}
+
+streamfx::util::tracer::~tracer() {}
+
+streamfx::util::tracer::tracer()
+	: _id(_tracer_ids.fetch_add(1)), _epoch(std::chrono::steady_clock::now()), _buffers(), _buffers_free(), _tracks(),
+	  _buffers_lock()
+{}
+
+void streamfx::util::tracer::record(uint32_t name, trace_category category, std::chrono::steady_clock::time_point start,
+									std::chrono::nanoseconds duration)
+{
+	local_buffer()->push((static_cast<uint64_t>(category) << 32) | name,
+						 static_cast<uint64_t>(std::max<int64_t>((start - _epoch).count(), 0)),
+						 static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+}
+
+void streamfx::util::tracer::record(std::string_view track, uint32_t name, trace_category category,
+									std::chrono::steady_clock::time_point start, std::chrono::nanoseconds duration)
+{
+	buffer* target;
+	{
+		std::unique_lock<std::mutex> lock(_buffers_lock);
+		if (auto kv = _tracks.find(track); kv != _tracks.end()) {
+			target = kv->second.get();
+		} else {
+			auto entry  = std::make_shared<buffer>(_buffers.size());
+			entry->name = track;
+			_buffers.push_back(entry);
+			_tracks.emplace(track, entry);
+			target = entry.get();
+		}
+	}
+
+	target->push((static_cast<uint64_t>(category) << 32) | name,
+				 static_cast<uint64_t>(std::max<int64_t>((start - _epoch).count(), 0)),
+				 static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+}
+
+void streamfx::util::tracer::save(std::filesystem::path path)
+{
+	// Grab everything first, so that the file reflects a single moment as closely as possible.
+	std::vector<std::pair<std::string, std::vector<std::array<uint64_t, 3>>>> threads;
+	{
+		std::vector<std::shared_ptr<buffer>> buffers;
+		{
+			std::unique_lock<std::mutex> lock(_buffers_lock);
+			buffers = _buffers;
+			for (auto& buf : buffers) {
+				threads.emplace_back(buf->name.empty() ? ("Thread " + std::to_string(buf->index + 1)) : buf->name,
+									 std::vector<std::array<uint64_t, 3>>());
+			}
+		}
+		for (std::size_t idx = 0; idx < buffers.size(); idx++) {
+			buffers[idx]->read(threads[idx].second);
+		}
+	}
+
+	// Names are only ever added, so a copy taken after reading the events covers all of them.
+	std::vector<std::string> strings;
+	{
+		auto&                               table = names();
+		std::shared_lock<std::shared_mutex> lock(table.lock);
+		strings.assign(table.names.begin(), table.names.end());
+	}
+
+	std::error_code ec;
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path(), ec);
+	}
+
+	std::ofstream stream(path, std::ios::out | std::ios::trunc);
+	if (!stream) {
+		throw std::runtime_error("Failed to open file for writing.");
+	}
+
+	// Chrome trace events are in microseconds, keep the nanoseconds.
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	for (std::size_t idx = 0; idx < threads.size(); idx++) {
+		std::size_t tid = idx + 1;
+		stream << ((idx == 0) ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+			   << ",\"args\":{\"name\":\"" << escape_json(threads[idx].first) << "\"}}";
+
+		for (auto& ev : threads[idx].second) {
+			uint32_t name     = static_cast<uint32_t>(ev[0] & 0xFFFFFFFF);
+			uint32_t category = static_cast<uint32_t>(ev[0] >> 32);
+			if ((name >= strings.size()) || (category >= std::size(category_names))) {
+				continue;
+			}
+
+			stream << ",{\"name\":\"" << escape_json(strings[name]) << "\",\"cat\":\""
+				   << category_names[category] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+				   << ",\"ts\":" << (double_t(ev[1]) / 1000.) << ",\"dur\":" << (double_t(ev[2]) / 1000.) << "}";
+		}
+	}
+	stream << "]}\n";
+
+	D_LOG_INFO("Saved trace to '%s'.", path.u8string().c_str());
+}
+
+streamfx::util::tracer::buffer* streamfx::util::tracer::local_buffer()
+{
+	if (_local.tracer != _id) {
+		std::unique_lock<std::mutex> lock(_buffers_lock);
+		buffer*                      entry;
+		if (!_buffers_free.empty()) {
+			// Only events recorded from now on belong to this thread.
+			entry = _buffers_free.back();
+			_buffers_free.pop_back();
+			entry->origin.store(entry->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		} else {
+			_buffers.push_back(std::make_shared<buffer>(_buffers.size()));
+			entry = _buffers.back().get();
+		}
+		entry->name = _local.name;
+
+		_local.tracer = _id;
+		_local.buffer = entry;
+	}
+	return _local.buffer;
+}
+
+uint32_t streamfx::util::tracer::intern(std::string_view name)
+{
+	auto& table = names();
+	{
+		std::shared_lock<std::shared_mutex> lock(table.lock);
+		if (auto kv = table.ids.find(name); kv != table.ids.end()) {
+			return kv->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(table.lock);
+	if (auto kv = table.ids.find(name); kv != table.ids.end()) {
+		return kv->second;
+	}
+	auto id = static_cast<uint32_t>(table.names.size());
+	table.names.emplace_back(name);
+	table.ids.emplace(table.names.back(), id);
+	return id;
+}
+
+void streamfx::util::tracer::name_thread(std::string_view name)
+{
+	_local.name = name;
+
+	if (auto self = instance(); self && (_local.tracer == self->_id)) {
+		std::unique_lock<std::mutex> lock(self->_buffers_lock);
+		_local.buffer->name = name;
+	}
+}
+
+void streamfx::util::tracer::initialize()
+{
+	if (std::atomic_load(&_tracer))
+		return;
+
+	// Recording isn't free, so this has to be requested explicitly.
+	if (auto config = streamfx::configuration::instance(); config) {
+		auto dataptr = config->get();
+		if (obs_data_get_bool(dataptr.get(), ST_CFG_TRACE)) {
+			auto tracer = std::make_shared<streamfx::util::tracer>();
+			std::atomic_store(&_tracer, tracer);
+			_tracer_raw.store(tracer.get(), std::memory_order_release);
+			D_LOG_INFO("Trace recording is enabled.", "");
+		}
+	}
+}
+
+void streamfx::util::tracer::finalize()
+{
+	_tracer_raw.store(nullptr, std::memory_order_release);
+	std::atomic_store(&_tracer, std::shared_ptr<streamfx::util::tracer>());
+}
+
+std::shared_ptr<streamfx::util::tracer> streamfx::util::tracer::instance()
+{
+	return std::atomic_load(&_tracer);
+}
+
+streamfx::util::tracer* streamfx::util::tracer::current()
+{
+	return _tracer_raw.load(std::memory_order_acquire);
+}
@@ -0,0 +1,117 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2020 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include "common.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace streamfx::util {
+	enum class trace_category : uint8_t {
+		SCOPE,  // Profiler scopes.
+		MARKER, // CPU side of graphics debug markers.
+		GPU,    // GPU side of graphics debug markers.
+		TASK,   // Thread pool tasks.
+		WAIT,   // Waiting on a shared resource, like the graphics context.
+	};
+
+	/** Records timed spans into per-thread ring buffers, which can be saved as a Chrome trace for Perfetto.
+	 *
+	 * Each thread only ever writes to its own buffer, so recording on the calling thread only takes a lock the first
+	 * time a thread records something. Recording to a named track and interning a name always take a lock. A buffer
+	 * only keeps the latest events, so a trace always covers the moments right before it was saved. Buffers of threads
+	 * that exited are handed to new threads, so the memory used is bounded by the number of threads alive at once.
+	 */
+	class tracer {
+		public:
+		class buffer;
+
+		private:
+		uint64_t                              _id;
+		std::chrono::steady_clock::time_point _epoch;
+
+		std::vector<std::shared_ptr<buffer>>                        _buffers;
+		std::vector<buffer*>                                        _buffers_free;
+		std::map<std::string, std::shared_ptr<buffer>, std::less<>> _tracks;
+		std::mutex                                                  _buffers_lock;
+
+		public:
+		/** Record a span from creation until destruction. */
+		class scope {
+			tracer*                               _parent;
+			uint32_t                              _name;
+			trace_category                        _category;
+			std::chrono::steady_clock::time_point _start;
+
+			public:
+			scope(uint32_t name, trace_category category);
+			~scope();
+		};
+
+		public:
+		~tracer();
+		tracer();
+
+		/** Record a span which started at 'start' and took 'duration' on the calling thread. */
+		void record(uint32_t name, trace_category category, std::chrono::steady_clock::time_point start,
+					std::chrono::nanoseconds duration);
+
+		/** Record a span on a separate named track, for work which happens elsewhere (like on the GPU).
+		 *
+		 * Each track must only be written to by one thread at a time.
+		 */
+		void record(std::string_view track, uint32_t name, trace_category category,
+					std::chrono::steady_clock::time_point start, std::chrono::nanoseconds duration);
+
+		/** Save the recorded events as Chrome trace event JSON. */
+		void save(std::filesystem::path path);
+
+		private:
+		buffer* local_buffer();
+
+		public:
+		/** Turn a name into an id which remains valid for the lifetime of the process.
+		 *
+		 * Ids are never released, so only intern a bounded set of names, like string literals.
+		 */
+		static uint32_t intern(std::string_view name);
+
+		/** Give the calling thread a name, which is shown instead of its number in the trace. */
+		static void name_thread(std::string_view name);
+
+		public /* Singleton */:
+		static void                                    initialize();
+		static void                                    finalize();
+		static std::shared_ptr<streamfx::util::tracer> instance();
+
+		/** Like instance(), but without touching a reference count, for things which record very often.
+		 *
+		 * The tracer is finalized after everything that records has stopped, so the pointer may be used until then.
+		 */
+		static streamfx::util::tracer* current();
+	};
+} // namespace streamfx::util